@@ -1,20 +1,55 @@
 #include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/board.h"
+#include "arcade_machine/debug_server.h"
+#include "arcade_machine/metrics.h"
+#include "arcade_machine/sound.h"
+#include "arcade_machine/state_hash.h"
+#include "i8080/debug.h"
+
+static uint8_t port_in(void* io, uint8_t port) {
+  machine_t* machine = io;
+  uint8_t (*in)(machine_t*) = machine->ports->in[port];
+
+  return in ? in(machine) : machine->cpu.a;
+}
+
+static void port_out(void* io, uint8_t port, uint8_t value) {
+  machine_t* machine = io;
+  void (*out)(machine_t*, uint8_t) = machine->ports->out[port];
+
+  if (out)
+    out(machine, value);
+}
 
-machine_t* create_machine() {
+static void connect_ports(machine_t* machine) {
+  machine->cpu.in = port_in;
+  machine->cpu.out = port_out;
+  machine->cpu.io = machine;
+}
+
+machine_t* create_machine(const machine_board_t* board) {
   machine_t* machine = calloc(1, sizeof(machine_t));
+  machine->board = board;
 
-  machine->memory = malloc(I8080_MAX_MEMORY);
+  // zeroed so every run starts from the same power-on state
+  machine->memory = calloc(1, I8080_MAX_MEMORY);
 
   init_i8080(&machine->cpu);
   machine->cpu.external_memory =
       machine->memory;  // set cpu's memory reference to memory of machine
+  connect_ports(machine);
+
+  // board specific handlers are resolved here, not per instruction
+  machine->ports = board->ports;
+  machine->render = board->render;
 
-  machine->next_interrupt = 1;
-  machine->in_port1 = 1 << 3;  // bit 3 always set
-  machine->in_port2 = 0;
-  machine->shift0 = 0;
-  machine->shift1 = 0;
-  machine->shift_offset = 0;
+  machine->next_interrupt = board->interrupts[0];
+  machine->interrupt_deadline = MACHINE_HALF_CYCLES_PER_FRAME;
+  machine->frame_deadline = MACHINE_CYCLES_PER_FRAME;
+  machine->in_port1 = board->in_port1;
+  machine->in_port2 = board->in_port2;
+  machine->shifter.value = 0;
+  machine->shifter.offset = 0;
 
   memset(machine->screen_buffer, 0, sizeof(machine->screen_buffer));
 
@@ -22,100 +57,333 @@ machine_t* create_machine() {
 }
 
 void destroy_machine(machine_t* machine) {
+  free(machine->color_prom);
   free(machine->memory);
   free(machine);
 }
 
-// called every frame executing 2MHz/60fps clock cycles
-void machine_update_state(machine_t* machine) {
-  int cycle_count = 0;
+// executes one instruction including port access and pending interrupt,
+// returns cycles taken by the instruction
+int machine_step(machine_t* machine) {
+  const uint64_t start_cycles = machine->cpu.cycles;
 
-  while (cycle_count <= MACHINE_CYCLES_PER_FRAME) {
-    int start_cycles = machine->cpu.cycles;
+  // IN and OUT run in the cpu through the port handlers, so breakpoints,
+  // trace and profile see them like any other instruction
+  i8080_step(&machine->cpu);
 
-    i8080_step(&machine->cpu);
+  // instruction at pc did not execute
+  if (machine->cpu.debug && machine->cpu.debug->stop)
+    return 0;
 
-    cycle_count += machine->cpu.cycles - start_cycles;
+  const int cycle_count = machine->cpu.cycles - start_cycles;
+  machine_check_interrupt(machine);
 
-    uint8_t* opcode = &machine->memory[machine->cpu.pc];
+  return cycle_count;
+}
 
-    // handle INPUT/OUTPUT instructions which refer to machine ports
-    // i8080_step function skipped these instructions as they reference external
-    // hardware
-    if (*opcode == 0xdb) {  // IN
+void machine_check_interrupt(machine_t* machine) {
+  // RST 1 (0x08) interrupt when rendering reaches middle of screen
+  // RST 2 (0x10) interrupt at end of screen, every half frame of cycles
+  if (machine->cpu.cycles >= machine->interrupt_deadline) {
+    if (machine->cpu.ie) {
+      machine->cpu.ie = 0;
+      i8080_rst(&machine->cpu, machine->next_interrupt);
+      machine->cpu.cycles += 11;  // cycles taken by an interrupt
+    }
 
-      uint8_t port = opcode[1];
+    // RST 2 lands on every frame end and RST 1 half a frame before, the odd
+    // cycle of a frame goes to the second half so neither drifts
+    machine->interrupt_deadline +=
+        machine->interrupt_deadline % MACHINE_CYCLES_PER_FRAME == 0
+            ? MACHINE_HALF_CYCLES_PER_FRAME
+            : MACHINE_CYCLES_PER_FRAME - MACHINE_HALF_CYCLES_PER_FRAME;
+    machine->next_interrupt =
+        machine->next_interrupt == machine->board->interrupts[0]
+            ? machine->board->interrupts[1]
+            : machine->board->interrupts[0];
+  }
+}
 
-      switch (port) {
-        case 1:
-          machine->cpu.a = machine->in_port1;
-          break;
+// cycle in the frame at which the beam has drawn raster lines before line.
+// blanking and the top lines take the half frame up to RST 1, the rest of the
+// screen the half up to RST 2, as the interrupt schedule is evenly spaced
+static uint64_t beam_offset(int line) {
+  const int blanking = MACHINE_RASTER_LINES - MACHINE_VISIBLE_LINES;
 
-        case 2:
-          machine->cpu.a = machine->in_port2;
-          break;
+  if (line <= MACHINE_MID_SCREEN_LINE)
+    return (uint64_t)MACHINE_HALF_CYCLES_PER_FRAME * (blanking + line) /
+           (blanking + MACHINE_MID_SCREEN_LINE);
 
-        case 3: {
-          uint16_t v = (machine->shift1 << 8) | machine->shift0;
-          machine->cpu.a = (v >> (8 - machine->shift_offset)) & 0xff;
-        } break;
-      }
+  return MACHINE_HALF_CYCLES_PER_FRAME +
+         (uint64_t)MACHINE_HALF_CYCLES_PER_FRAME *
+             (line - MACHINE_MID_SCREEN_LINE) /
+             (MACHINE_VISIBLE_LINES - MACHINE_MID_SCREEN_LINE);
+}
 
-      machine->cpu.pc += 2;
-    } else if (*opcode == 0xd3) {  // OUT
+// first raster line the beam has not finished at the current cycle
+static int beam_line(const machine_t* machine) {
+  const uint64_t elapsed =
+      machine->cpu.cycles - (machine->frame_deadline - MACHINE_CYCLES_PER_FRAME);
+  int line = 0;
 
-      uint8_t port = opcode[1];
+  while (line < MACHINE_VISIBLE_LINES && beam_offset(line + 1) <= elapsed)
+    line++;
 
-      switch (port) {
-        case 2:
-          machine->shift_offset = machine->cpu.a & 0x7;
-          break;
+  return line;
+}
 
-        case 4:
-          machine->shift0 = machine->shift1;
-          machine->shift1 = machine->cpu.a;
-          break;
-      }
+// converts the lines the beam finished since line, returns the cycle at which
+// the next one is finished
+static uint64_t advance_beam(machine_t* machine, int* line) {
+  const int end = beam_line(machine);
+  if (end > *line)
+    machine->render(machine, machine->screen_buffer, *line, end);
+  *line = end;
 
-      machine->cpu.pc += 2;
-    }
+  if (end == MACHINE_VISIBLE_LINES)
+    return UINT64_MAX;
+
+  return machine->frame_deadline - MACHINE_CYCLES_PER_FRAME +
+         beam_offset(end + 1);
+}
 
-    // RST 1 (0x08) interrupt when rendering reaches middle of screen
-    // RST 2 (0x10) interrupt at end of screen
-    if (machine->cpu.cycles >= MACHINE_HALF_CYCLES_PER_FRAME) {
-      if (machine->cpu.ie) {
-        machine->cpu.ie = 0;
-        i8080_rst(&machine->cpu, machine->next_interrupt);
-        machine->cpu.cycles += 11;  // cycles taken by an interrupt
+static void count_update(machine_t* machine,
+                         uint64_t start_ns,
+                         uint64_t start_cycles,
+                         uint64_t frames) {
+  if (!machine->metrics)
+    return;
+
+  metrics_add(machine->metrics, METRIC_FRAMES, frames);
+  metrics_add(machine->metrics, METRIC_CYCLES,
+              machine->cpu.cycles - start_cycles);
+  metrics_add(machine->metrics, METRIC_UPDATE_STATE_NS,
+              metrics_now_ns() - start_ns);
+  metrics_publish(machine->metrics);
+}
+
+// called every frame, runs until the cpu reaches the frame deadline at
+// 2MHz/60fps clock cycles. returns false when the debugger stopped the cpu,
+// the next call continues the same frame. with a debug server attached the
+// stop is handled there instead. in scanline mode lines are converted as the
+// beam passes them, mid-frame video ram writes show where they happened
+bool machine_update_state(machine_t* machine) {
+  const uint64_t start_ns = machine->metrics ? metrics_now_ns() : 0;
+  const uint64_t start_cycles = machine->cpu.cycles;
+
+  // lines before the beam were converted before a debugger stop
+  int line = machine->scanline ? beam_line(machine) : MACHINE_VISIBLE_LINES;
+  uint64_t beam_deadline =
+      machine->scanline ? advance_beam(machine, &line) : UINT64_MAX;
+
+  while (machine->cpu.cycles < machine->frame_deadline) {
+    machine_step(machine);
+
+    if (machine->cpu.cycles >= beam_deadline)
+      beam_deadline = advance_beam(machine, &line);
+
+    if (machine->cpu.debug && machine->cpu.debug->stop) {
+      if (!machine->debug_server) {
+        count_update(machine, start_ns, start_cycles, 0);
+        return false;
       }
+      debug_server_stopped(machine->debug_server, machine);
 
-      machine->cpu.cycles -= MACHINE_HALF_CYCLES_PER_FRAME;
-      machine->next_interrupt = machine->next_interrupt == 1 ? 2 : 1;
+      // a client may have loaded a state
+      if (machine->scanline) {
+        line = beam_line(machine);
+        beam_deadline = advance_beam(machine, &line);
+      }
     }
   }
+  if (line < MACHINE_VISIBLE_LINES)
+    machine->render(machine, machine->screen_buffer, line,
+                    MACHINE_VISIBLE_LINES);
+  machine->frame_deadline += MACHINE_CYCLES_PER_FRAME;
+
+  if (machine->sound)
+    sound_advance(machine->sound, machine->cpu.cycles);
+
+  if (machine->hash_log)
+    state_hash_log_append(machine->hash_log, machine_state_hash(machine));
+
+  // commands from a debugger client are only looked at between frames
+  if (machine->debug_server &&
+      __atomic_load_n(&machine->debug_server->attention, __ATOMIC_ACQUIRE))
+    debug_server_service(machine->debug_server, machine);
+
+  count_update(machine, start_ns, start_cycles, 1);
+  return true;
+}
+
+void machine_save_state(const machine_t* machine,
+                        machine_snapshot_t* snapshot) {
+  snapshot->cpu = machine->cpu;
+  memcpy(snapshot->ram, &machine->memory[MACHINE_RAM_START], MACHINE_RAM_SIZE);
+
+  snapshot->interrupt_deadline = machine->interrupt_deadline;
+  snapshot->frame_deadline = machine->frame_deadline;
+  snapshot->next_interrupt = machine->next_interrupt;
+  snapshot->in_port1 = machine->in_port1;
+  snapshot->in_port2 = machine->in_port2;
+  snapshot->shifter = machine->shifter;
+}
+
+void machine_load_state(machine_t* machine,
+                        const machine_snapshot_t* snapshot) {
+  struct i8080_trace_t* trace = machine->cpu.trace;
+  struct i8080_profile_t* profile = machine->cpu.profile;
+  struct i8080_debug_t* debug = machine->cpu.debug;
+
+  machine->cpu = snapshot->cpu;
+  machine->cpu.external_memory = machine->memory;
+  connect_ports(machine);
+  machine->cpu.trace = trace;
+  machine->cpu.profile = profile;
+  machine->cpu.debug = debug;
+  memcpy(&machine->memory[MACHINE_RAM_START], snapshot->ram, MACHINE_RAM_SIZE);
+
+  machine->interrupt_deadline = snapshot->interrupt_deadline;
+  machine->frame_deadline = snapshot->frame_deadline;
+  machine->next_interrupt = snapshot->next_interrupt;
+  machine->in_port1 = snapshot->in_port1;
+  machine->in_port2 = snapshot->in_port2;
+  machine->shifter = snapshot->shifter;
+}
+
+void machine_run_ahead(
+    machine_t* machine,
+    int frames,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+    uint8_t* vram) {
+  machine_snapshot_t snapshot;
+  machine_save_state(machine, &snapshot);
+
+  struct sound_t* sound = machine->sound;
+  FILE* hash_log = machine->hash_log;
+  struct latency_t* latency = machine->latency;
+  struct debug_server_t* debug_server = machine->debug_server;
+  struct metrics_thread_t* metrics = machine->metrics;
+  struct i8080_trace_t* trace = machine->cpu.trace;
+  struct i8080_profile_t* profile = machine->cpu.profile;
+  struct i8080_debug_t* debug = machine->cpu.debug;
+  machine->sound = NULL;
+  machine->hash_log = NULL;
+  machine->latency = NULL;
+  machine->debug_server = NULL;
+  machine->metrics = NULL;
+  machine->cpu.trace = NULL;
+  machine->cpu.profile = NULL;
+  machine->cpu.debug = NULL;
+
+  for (int frame = 0; frame < frames; frame++)
+    machine_update_state(machine);
+  machine_render_to(machine, buffer);
+  if (vram)
+    memcpy(vram, &machine->memory[MACHINE_VRAM_START], MACHINE_VRAM_SIZE);
+
+  machine->sound = sound;
+  machine->hash_log = hash_log;
+  machine->latency = latency;
+  machine->debug_server = debug_server;
+  machine->metrics = metrics;
+  machine->cpu.trace = trace;
+  machine->cpu.profile = profile;
+  machine->cpu.debug = debug;
+  machine_load_state(machine, &snapshot);
+}
+
+uint64_t machine_state_hash(const machine_t* machine) {
+  const i8080_t* cpu = &machine->cpu;
+
+  // serialized explicitly so hashes match across compilers
+  const uint8_t state[] = {
+      cpu->a,
+      cpu->b,
+      cpu->c,
+      cpu->d,
+      cpu->e,
+      cpu->h,
+      cpu->l,
+      cpu->cb.flags.s << 7 | cpu->cb.flags.z << 6 | cpu->cb.flags.ac << 4 |
+          cpu->cb.flags.p << 2 | 1 << 1 | cpu->cb.flags.c,
+      cpu->pc & 0xff,
+      cpu->pc >> 8,
+      cpu->sp & 0xff,
+      cpu->sp >> 8,
+      cpu->cycles & 0xff,
+      (cpu->cycles >> 8) & 0xff,
+      (cpu->cycles >> 16) & 0xff,
+      (cpu->cycles >> 24) & 0xff,
+      (cpu->cycles >> 32) & 0xff,
+      (cpu->cycles >> 40) & 0xff,
+      (cpu->cycles >> 48) & 0xff,
+      cpu->cycles >> 56,
+      cpu->ie,
+      machine->next_interrupt,
+      machine->in_port1,
+      machine->in_port2,
+      machine->shifter.value & 0xff,
+      machine->shifter.value >> 8,
+      machine->shifter.offset,
+  };
+
+  return state_hash64(&machine->memory[MACHINE_RAM_START], MACHINE_RAM_SIZE,
+                      state_hash64(state, sizeof(state), 0));
 }
 
 // called every frame, black and white
 void machine_update_screen_buffer(machine_t* machine) {
-  for (int x = 0; x < MACHINE_SCREEN_WIDTH; x++) {
-    uint16_t offset = 0x241f + (x * 0x20);
-
-    for (int y = 0; y < MACHINE_SCREEN_HEIGHT; y += 8) {
-      uint8_t byte = machine->memory[offset];
-
-      for (int bit = 0; bit < 8; bit++) {
-        if ((byte << bit) & 0x80) {
-          machine->screen_buffer[y + bit][x][0] = 255;
-          machine->screen_buffer[y + bit][x][1] = 255;
-          machine->screen_buffer[y + bit][x][2] = 255;
-        } else {
-          machine->screen_buffer[y + bit][x][0] = 0;
-          machine->screen_buffer[y + bit][x][1] = 0;
-          machine->screen_buffer[y + bit][x][2] = 0;
-        }
-      }
+  if (!machine->scanline)  // already drawn by the beam
+    machine_render_to(machine, machine->screen_buffer);
+}
+
+void machine_render_to(
+    const machine_t* machine,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3]) {
+  // lines were converted during the frame, conversion time counts as update
+  if (machine->scanline) {
+    memcpy(buffer, machine->screen_buffer, sizeof(machine->screen_buffer));
+    return;
+  }
+
+  if (!machine->metrics) {
+    machine->render(machine, buffer, 0, MACHINE_VISIBLE_LINES);
+    return;
+  }
+
+  // published with the next frame
+  const uint64_t start_ns = metrics_now_ns();
+  machine->render(machine, buffer, 0, MACHINE_VISIBLE_LINES);
+  metrics_add(machine->metrics, METRIC_SCREEN_BUFFER_NS,
+              metrics_now_ns() - start_ns);
+}
+
+void machine_render_vram(
+    const uint8_t* vram,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3]) {
+  for (int line = 0; line < MACHINE_VISIBLE_LINES; line++)
+    machine_render_line(&vram[line * MACHINE_LINE_BYTES], NULL, buffer, line);
+}
 
-      offset--;
+// branch free, every pixel is the color masked by its bit
+void machine_render_line(
+    const uint8_t* vram_line,
+    const uint8_t* colors,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+    int line) {
+  static const uint8_t white[3] = {255, 255, 255};
+
+  for (int i = 0; i < MACHINE_LINE_BYTES; i++) {
+    const uint8_t byte = vram_line[i];
+    const uint8_t* color = colors ? &colors[3 * i] : white;
+    const int y = (MACHINE_LINE_BYTES - 1 - i) * 8;
+
+    for (int bit = 0; bit < 8; bit++) {
+      const uint8_t mask = -((byte >> (7 - bit)) & 1);
+      buffer[y + bit][line][0] = color[0] & mask;
+      buffer[y + bit][line][1] = color[1] & mask;
+      buffer[y + bit][line][2] = color[2] & mask;
     }
   }
 }
@@ -141,9 +409,32 @@ void machine_file_to_mem(machine_t* machine,
   fclose(file);
 }
 
-void machine_load_invaders(machine_t* machine) {
-  machine_file_to_mem(machine, "res/roms/invaders.h", 0x0);
-  machine_file_to_mem(machine, "res/roms/invaders.g", 0x800);
-  machine_file_to_mem(machine, "res/roms/invaders.f", 0x1000);
-  machine_file_to_mem(machine, "res/roms/invaders.e", 0x1800);
+void machine_load_roms(machine_t* machine) {
+  const machine_board_t* board = machine->board;
+
+  for (int i = 0; i < MACHINE_BOARD_ROMS && board->roms[i].file_name; i++) {
+    char file_name[256];
+    snprintf(file_name, sizeof(file_name), "%s/%s", MACHINE_ROM_DIRECTORY,
+             board->roms[i].file_name);
+    machine_file_to_mem(machine, file_name, board->roms[i].address);
+  }
+
+  if (!board->color_prom)
+    return;
+
+  // optional, video falls back to white without it
+  char file_name[256];
+  snprintf(file_name, sizeof(file_name), "%s/%s", MACHINE_ROM_DIRECTORY,
+           board->color_prom);
+
+  FILE* file = fopen(file_name, "rb");
+  if (!file) {
+    printf("Could not read color prom %s, using monochrome video\n",
+           file_name);
+    return;
+  }
+
+  machine->color_prom = calloc(1, MACHINE_COLOR_PROM_SIZE);
+  fread(machine->color_prom, 1, MACHINE_COLOR_PROM_SIZE, file);
+  fclose(file);
 }
@@ -0,0 +1,325 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arcade_machine/archive.h"
+
+static void write_u16(uint8_t* buffer, uint16_t value) {
+  buffer[0] = value & 0xff;
+  buffer[1] = value >> 8;
+}
+
+static void write_u32(uint8_t* buffer, uint32_t value) {
+  write_u16(buffer, value & 0xffff);
+  write_u16(buffer + 2, value >> 16);
+}
+
+static void write_u64(uint8_t* buffer, uint64_t value) {
+  write_u32(buffer, value & 0xffffffff);
+  write_u32(buffer + 4, value >> 32);
+}
+
+static uint16_t read_u16(const uint8_t* buffer) {
+  return buffer[0] | (buffer[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t* buffer) {
+  return read_u16(buffer) | ((uint32_t)read_u16(buffer + 2) << 16);
+}
+
+static uint64_t read_u64(const uint8_t* buffer) {
+  return read_u32(buffer) | ((uint64_t)read_u32(buffer + 4) << 32);
+}
+
+// packbits: control byte n < 128 is followed by n + 1 literal bytes, n >= 128
+// by one byte repeated n - 125 times
+static uint32_t rle_encode(const uint8_t* data, uint32_t length, uint8_t* out) {
+  uint32_t size = 0;
+
+  for (uint32_t i = 0; i < length;) {
+    uint32_t run = 1;
+    while (i + run < length && run < 130 && data[i + run] == data[i])
+      run++;
+
+    if (run >= 3) {
+      out[size++] = run + 125;
+      out[size++] = data[i];
+      i += run;
+      continue;
+    }
+
+    // literals until the next run of three
+    uint32_t literals = 0;
+    while (i + literals < length && literals < 128 &&
+           !(i + literals + 2 < length &&
+             data[i + literals] == data[i + literals + 1] &&
+             data[i + literals] == data[i + literals + 2]))
+      literals++;
+
+    out[size++] = literals - 1;
+    memcpy(&out[size], &data[i], literals);
+    size += literals;
+    i += literals;
+  }
+
+  return size;
+}
+
+// decodes into out, xor with its contents for deltas. false on corrupt data
+static bool rle_decode(const uint8_t* data,
+                       uint32_t size,
+                       uint8_t* out,
+                       uint32_t length,
+                       bool delta) {
+  uint32_t position = 0;
+
+  for (uint32_t i = 0; i < size;) {
+    const uint8_t control = data[i++];
+
+    if (control < 128) {
+      const uint32_t literals = control + 1;
+      if (i + literals > size || position + literals > length)
+        return false;
+
+      for (uint32_t j = 0; j < literals; j++)
+        out[position + j] = delta ? out[position + j] ^ data[i + j]
+                                  : data[i + j];
+      i += literals;
+      position += literals;
+    } else {
+      const uint32_t run = control - 125;
+      if (i >= size || position + run > length)
+        return false;
+
+      for (uint32_t j = 0; j < run; j++)
+        out[position + j] = delta ? out[position + j] ^ data[i] : data[i];
+      i++;
+      position += run;
+    }
+  }
+
+  return position == length;
+}
+
+archive_writer_t* archive_create(const char* file_name,
+                                 uint32_t keyframe_interval) {
+  archive_writer_t* writer = calloc(1, sizeof(archive_writer_t));
+
+  writer->file = fopen(file_name, "wb");
+  if (!writer->file) {
+    printf("Could not write file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+  writer->keyframe_interval = keyframe_interval;
+
+  // magic, version, fps, frame count, keyframe interval, index offset,
+  // index count. counts and index are filled in by archive_finish
+  uint8_t header[ARCHIVE_HEADER_SIZE] = {0};
+  memcpy(header, ARCHIVE_MAGIC, 4);
+  write_u16(&header[4], ARCHIVE_VERSION);
+  write_u16(&header[6], MACHINE_FPS);
+  write_u32(&header[12], keyframe_interval);
+  fwrite(header, sizeof(header), 1, writer->file);
+
+  return writer;
+}
+
+static void write_record(archive_writer_t* writer,
+                         const uint8_t* vram,
+                         uint32_t frames) {
+  uint8_t record[ARCHIVE_RECORD_SIZE + ARCHIVE_MAX_PAYLOAD];
+  uint32_t size = 0;
+
+  if (writer->frame_count % writer->keyframe_interval == 0) {
+    if (writer->index_count == writer->index_capacity) {
+      writer->index_capacity =
+          writer->index_capacity ? writer->index_capacity * 2 : 64;
+      writer->index =
+          realloc(writer->index, writer->index_capacity * sizeof(uint64_t));
+    }
+    writer->index[writer->index_count++] = ftell(writer->file);
+
+    record[0] = ARCHIVE_KEYFRAME;
+    size = rle_encode(vram, MACHINE_VRAM_SIZE, &record[ARCHIVE_RECORD_SIZE]);
+  } else {
+    record[0] = ARCHIVE_DELTA;
+
+    // only when a run was split, repeats are counted in frames
+    if (memcmp(vram, writer->previous, MACHINE_VRAM_SIZE) != 0) {
+      uint8_t delta[MACHINE_VRAM_SIZE];
+      for (int i = 0; i < MACHINE_VRAM_SIZE; i++)
+        delta[i] = vram[i] ^ writer->previous[i];
+
+      size = rle_encode(delta, MACHINE_VRAM_SIZE, &record[ARCHIVE_RECORD_SIZE]);
+    }
+  }
+
+  write_u16(&record[1], frames);
+  write_u16(&record[3], size);
+  fwrite(record, ARCHIVE_RECORD_SIZE + size, 1, writer->file);
+
+  memcpy(writer->previous, vram, MACHINE_VRAM_SIZE);
+  writer->frame_count += frames;
+}
+
+void archive_append(archive_writer_t* writer,
+                    const uint8_t* vram,
+                    uint32_t frames) {
+  // a run is split at keyframes and when it outgrows the record field
+  while (frames > 0) {
+    uint32_t run = writer->keyframe_interval -
+                   writer->frame_count % writer->keyframe_interval;
+    if (run > frames)
+      run = frames;
+    if (run > ARCHIVE_MAX_FRAMES)
+      run = ARCHIVE_MAX_FRAMES;
+
+    write_record(writer, vram, run);
+    frames -= run;
+  }
+}
+
+void archive_finish(archive_writer_t* writer) {
+  const uint64_t index_offset = ftell(writer->file);
+
+  for (uint32_t i = 0; i < writer->index_count; i++) {
+    uint8_t offset[8];
+    write_u64(offset, writer->index[i]);
+    fwrite(offset, sizeof(offset), 1, writer->file);
+  }
+
+  uint8_t fields[20];
+  write_u32(&fields[0], writer->frame_count);
+  write_u32(&fields[4], writer->keyframe_interval);
+  write_u64(&fields[8], index_offset);
+  write_u32(&fields[16], writer->index_count);
+  fseek(writer->file, 8, SEEK_SET);
+  fwrite(fields, sizeof(fields), 1, writer->file);
+
+  fclose(writer->file);
+  free(writer->index);
+  free(writer);
+}
+
+archive_t* archive_open(const char* file_name) {
+  const int fd = open(file_name, O_RDONLY);
+  if (fd < 0) {
+    printf("Could not read file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  struct stat status;
+  fstat(fd, &status);
+
+  void* data = status.st_size >= ARCHIVE_HEADER_SIZE
+                   ? mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)
+                   : MAP_FAILED;
+  close(fd);
+
+  const uint8_t* header = data;
+  if (data == MAP_FAILED || memcmp(header, ARCHIVE_MAGIC, 4) != 0) {
+    printf("Not a frame archive: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  if (read_u16(&header[4]) != ARCHIVE_VERSION) {
+    printf("Frame archive version %u not supported, expected %u: %s\n",
+           read_u16(&header[4]), ARCHIVE_VERSION, file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  archive_t* archive = calloc(1, sizeof(archive_t));
+  archive->data = data;
+  archive->size = status.st_size;
+  archive->frame_count = read_u32(&header[8]);
+  archive->keyframe_interval = read_u32(&header[12]);
+  archive->index_count = read_u32(&header[24]);
+
+  const uint64_t index_offset = read_u64(&header[16]);
+  if (archive->keyframe_interval == 0 || index_offset > archive->size ||
+      (archive->size - index_offset) / 8 < archive->index_count ||
+      archive->index_count <
+          (archive->frame_count + archive->keyframe_interval - 1) /
+              archive->keyframe_interval) {
+    printf("Corrupt frame archive: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+  archive->index = &archive->data[index_offset];
+
+  return archive;
+}
+
+void archive_close(archive_t* archive) {
+  munmap((void*)archive->data, archive->size);
+  free(archive);
+}
+
+bool archive_seek(archive_t* archive, uint32_t frame) {
+  if (frame >= archive->frame_count)
+    return false;
+
+  if (frame >= archive->cursor_first && frame < archive->cursor_end)
+    return true;
+
+  // continue after the cursor when it lies between the keyframe and frame
+  const uint32_t keyframe = frame / archive->keyframe_interval;
+  uint32_t current;
+  uint64_t offset;
+
+  if (archive->cursor_end && archive->cursor_end <= frame &&
+      archive->cursor_first >= keyframe * archive->keyframe_interval) {
+    current = archive->cursor_end;
+    offset = archive->cursor_offset;
+  } else {
+    current = keyframe * archive->keyframe_interval;
+    offset = read_u64(&archive->index[keyframe * 8]);
+  }
+  archive->cursor_end = 0;
+
+  while (current <= frame) {
+    if (offset + ARCHIVE_RECORD_SIZE > archive->size)
+      return false;
+
+    const uint8_t* record = &archive->data[offset];
+    const uint32_t frames = read_u16(&record[1]);
+    const uint32_t size = read_u16(&record[3]);
+    if (offset + ARCHIVE_RECORD_SIZE + size > archive->size || frames == 0)
+      return false;
+
+    // keyframes start exactly on the interval, no record crosses one
+    const uint32_t next_keyframe =
+        (current / archive->keyframe_interval + 1) * archive->keyframe_interval;
+    const bool delta = record[0] == ARCHIVE_DELTA;
+    if ((current % archive->keyframe_interval == 0 ? delta : !delta) ||
+        frames > next_keyframe - current)
+      return false;
+
+    // an empty delta repeats the previous frame
+    if ((size || !delta) &&
+        !rle_decode(&record[ARCHIVE_RECORD_SIZE], size, archive->vram,
+                    MACHINE_VRAM_SIZE, delta))
+      return false;
+
+    archive->cursor_first = current;
+    current += frames;
+    offset += ARCHIVE_RECORD_SIZE + size;
+  }
+
+  archive->cursor_end = current;
+  archive->cursor_offset = offset;
+  return true;
+}
+
+bool archive_render(archive_t* archive,
+                    uint32_t frame,
+                    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH]
+                                  [3]) {
+  if (!archive_seek(archive, frame))
+    return false;
+
+  machine_render_vram(archive->vram, buffer);
+  return true;
+}
@@ -0,0 +1,211 @@
+#include "arcade_machine/board.h"
+#include "arcade_machine/latency.h"
+#include "arcade_machine/sound.h"
+
+static uint8_t in_port1(machine_t* machine) {
+  if (machine->latency)
+    latency_input_read(machine->latency);
+
+  return machine->in_port1;
+}
+
+static uint8_t in_port2(machine_t* machine) {
+  if (machine->latency)
+    latency_input_read(machine->latency);
+
+  return machine->in_port2;
+}
+
+static uint8_t in_shift_result(machine_t* machine) {
+  return machine->shifter.value >> (8 - machine->shifter.offset);
+}
+
+static void out_shift_offset(machine_t* machine, uint8_t value) {
+  machine->shifter.offset = value & 0x7;
+}
+
+static void out_shift_data(machine_t* machine, uint8_t value) {
+  machine->shifter.value = (value << 8) | (machine->shifter.value >> 8);
+}
+
+static void out_sound(machine_t* machine, uint8_t port, uint8_t value) {
+  if (machine->sound)
+    sound_port_write(machine->sound, port, value, machine->cpu.cycles);
+}
+
+static void out_sound1(machine_t* machine, uint8_t value) {
+  out_sound(machine, 3, value);
+}
+
+static void out_sound2(machine_t* machine, uint8_t value) {
+  out_sound(machine, 5, value);
+}
+
+// watchdog reset, not emulated
+static void out_watchdog(machine_t* machine, uint8_t value) {
+  (void)machine;
+  (void)value;
+}
+
+// the Space Invaders port map, used by every board below. the other games
+// have their own sound hardware on ports 3 and 5, their writes trigger the
+// Space Invaders effects instead. bits for cocktail screen flip or colour
+// banks are ignored, as are any ports outside this map
+static const machine_ports_t MIDWAY_8080_PORTS = {
+    .in =
+        {
+            [1] = in_port1,
+            [2] = in_port2,
+            [3] = in_shift_result,
+        },
+    .out =
+        {
+            [2] = out_shift_offset,
+            [3] = out_sound1,
+            [4] = out_shift_data,
+            [5] = out_sound2,
+            [6] = out_watchdog,
+        },
+};
+
+static void render_mono(
+    const machine_t* machine,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+    int first_line,
+    int end_line) {
+  const uint8_t* vram = &machine->memory[MACHINE_VRAM_START];
+
+  for (int line = first_line; line < end_line; line++)
+    machine_render_line(&vram[line * MACHINE_LINE_BYTES], NULL, buffer, line);
+}
+
+// each 8x8 pixel cell takes its color from the prom, 3 bits red, blue, green
+static void render_color_prom(
+    const machine_t* machine,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+    int first_line,
+    int end_line) {
+  if (!machine->color_prom) {
+    render_mono(machine, buffer, first_line, end_line);
+    return;
+  }
+
+  const uint8_t* vram = &machine->memory[MACHINE_VRAM_START];
+  uint8_t colors[MACHINE_LINE_BYTES * 3];
+
+  for (int line = first_line; line < end_line; line++) {
+    const uint16_t offset = line * MACHINE_LINE_BYTES;
+
+    for (int i = 0; i < MACHINE_LINE_BYTES; i++) {
+      const uint8_t color = machine->color_prom[((offset >> 8) << 5) | i];
+      colors[3 * i + 0] = color & 0x1 ? 255 : 0;  // red
+      colors[3 * i + 1] = color & 0x4 ? 255 : 0;  // green
+      colors[3 * i + 2] = color & 0x2 ? 255 : 0;  // blue
+    }
+
+    machine_render_line(&vram[offset], colors, buffer, line);
+  }
+}
+
+// rom file names follow the usual dump names of each set. all boards share
+// MIDWAY_8080_PORTS and the interrupt schedule, they differ in roms, dip
+// switch defaults and colour prom
+const machine_board_t MACHINE_BOARDS[] = {
+    {
+        .name = "invaders",
+        .title = "Space Invaders",
+        .roms = {{"invaders.h", 0x0000},
+                 {"invaders.g", 0x0800},
+                 {"invaders.f", 0x1000},
+                 {"invaders.e", 0x1800}},
+        .ports = &MIDWAY_8080_PORTS,
+        .interrupts = {1, 2},
+        .in_port1 = 1 << 3,  // bit 3 always set
+        .render = render_mono,
+    },
+    {
+        .name = "invadpt2",
+        .title = "Space Invaders Part II",
+        .roms = {{"pv01", 0x0000},
+                 {"pv02", 0x0800},
+                 {"pv03", 0x1000},
+                 {"pv04", 0x1800},
+                 {"pv05", 0x4000}},
+        .color_prom = "pv06.1",
+        .ports = &MIDWAY_8080_PORTS,
+        .interrupts = {1, 2},
+        .in_port1 = 1 << 3,
+        .render = render_color_prom,
+    },
+    {
+        .name = "lrescue",
+        .title = "Lunar Rescue",
+        .roms = {{"lrescue.1", 0x0000},
+                 {"lrescue.2", 0x0800},
+                 {"lrescue.3", 0x1000},
+                 {"lrescue.4", 0x1800},
+                 {"lrescue.5", 0x4000},
+                 {"lrescue.6", 0x4800}},
+        .color_prom = "7643-1.cpu",
+        .ports = &MIDWAY_8080_PORTS,
+        .interrupts = {1, 2},
+        .in_port1 = 1 << 3,
+        .render = render_color_prom,
+    },
+    {
+        .name = "ballbomb",
+        .title = "Balloon Bomber",
+        .roms = {{"tn01", 0x0000},
+                 {"tn02", 0x0800},
+                 {"tn03", 0x1000},
+                 {"tn04", 0x1800},
+                 {"tn05-1", 0x4000}},
+        .color_prom = "tn06",
+        .ports = &MIDWAY_8080_PORTS,
+        .interrupts = {1, 2},
+        .in_port1 = 1 << 3,
+        .render = render_color_prom,
+    },
+};
+
+const size_t MACHINE_BOARD_COUNT =
+    sizeof(MACHINE_BOARDS) / sizeof(MACHINE_BOARDS[0]);
+
+const machine_board_t* machine_find_board(const char* name) {
+  for (size_t i = 0; i < MACHINE_BOARD_COUNT; i++) {
+    if (strcmp(MACHINE_BOARDS[i].name, name) == 0)
+      return &MACHINE_BOARDS[i];
+  }
+
+  return NULL;
+}
+
+const machine_board_t* machine_select_board(const char* requested,
+                                            const char* recorded) {
+  const bool has_requested = requested && requested[0];
+  const bool has_recorded = recorded && recorded[0];
+
+  // replaying on other hardware desyncs the input ports and hash logs
+  if (has_requested && has_recorded && strcmp(requested, recorded) != 0) {
+    printf("Movie was recorded on board %s, not %s\n", recorded, requested);
+    return NULL;
+  }
+
+  const char* name = has_requested  ? requested
+                     : has_recorded ? recorded
+                                    : MACHINE_DEFAULT_BOARD;
+  const machine_board_t* board = machine_find_board(name);
+  if (!board) {
+    printf("Unknown board: %s\n", name);
+    machine_print_boards();
+  }
+
+  return board;
+}
+
+void machine_print_boards(void) {
+  printf("boards:");
+  for (size_t i = 0; i < MACHINE_BOARD_COUNT; i++)
+    printf(" %s (%s)", MACHINE_BOARDS[i].name, MACHINE_BOARDS[i].title);
+  printf("\n");
+}
@@ -0,0 +1,138 @@
+#include "arcade_machine/capture.h"
+
+#define CAPTURE_Y4M_HEADER "YUV4MPEG2 W224 H256 F60:1 Ip A1:1 Cmono\n"
+
+// y4m has a fixed frame rate, an image shown for several frames is written
+// out in full for each of them
+static void write_y4m(capture_t* capture,
+                      const uint8_t* vram,
+                      uint32_t repeat) {
+  machine_render_vram(vram, capture->rgb);
+  for (int y = 0; y < MACHINE_SCREEN_HEIGHT; y++) {
+    for (int x = 0; x < MACHINE_SCREEN_WIDTH; x++)
+      capture->luma[y][x] = capture->rgb[y][x][0];
+  }
+
+  for (uint32_t i = 0; i < repeat; i++) {
+    fputs("FRAME\n", capture->file);
+    fwrite(capture->luma, sizeof(capture->luma), 1, capture->file);
+  }
+}
+
+// repeat is the number of frames showing this image
+static void write_frame(capture_t* capture,
+                        const uint8_t* vram,
+                        uint32_t repeat) {
+  if (capture->format == CAPTURE_Y4M) {
+    write_y4m(capture, vram, repeat);
+    return;
+  }
+
+  archive_append(capture->archive, vram, repeat);
+}
+
+static void* writer(void* argument) {
+  capture_t* capture = argument;
+  capture_entry_t pending;  // repeated until the next frame index is known
+  bool has_pending = false;
+
+  pthread_mutex_lock(&capture->lock);
+  while (true) {
+    while (capture->head == capture->tail && !capture->closing)
+      pthread_cond_wait(&capture->changed, &capture->lock);
+
+    if (capture->head == capture->tail)
+      break;
+
+    // copied out so the emulation thread can refill the slot meanwhile
+    capture_entry_t entry = capture->queue[capture->tail % CAPTURE_QUEUE];
+    capture->tail++;
+    pthread_cond_signal(&capture->changed);
+    pthread_mutex_unlock(&capture->lock);
+
+    if (has_pending)
+      write_frame(capture, pending.vram, entry.frame - pending.frame);
+    pending = entry;
+    has_pending = true;
+
+    pthread_mutex_lock(&capture->lock);
+  }
+  pthread_mutex_unlock(&capture->lock);
+
+  // frames is final once closing is set
+  if (has_pending)
+    write_frame(capture, pending.vram, capture->frames - pending.frame);
+
+  return NULL;
+}
+
+capture_t* create_capture(const char* file_name) {
+  capture_t* capture = calloc(1, sizeof(capture_t));
+
+  const char* extension = strrchr(file_name, '.');
+  capture->format = extension && strcmp(extension, ".y4m") == 0
+                        ? CAPTURE_Y4M
+                        : CAPTURE_ARCHIVE;
+
+  if (capture->format == CAPTURE_Y4M) {
+    capture->file = fopen(file_name, "wb");
+    if (!capture->file) {
+      printf("Could not write file: %s\n", file_name);
+      exit(EXIT_FAILURE);
+    }
+    fputs(CAPTURE_Y4M_HEADER, capture->file);
+  } else {
+    capture->archive = archive_create(file_name, ARCHIVE_KEYFRAME_INTERVAL);
+  }
+
+  pthread_mutex_init(&capture->lock, NULL);
+  pthread_cond_init(&capture->changed, NULL);
+  pthread_create(&capture->thread, NULL, writer, capture);
+
+  return capture;
+}
+
+void capture_frame(capture_t* capture, const uint8_t* memory) {
+  const uint8_t* vram = &memory[MACHINE_VRAM_START];
+  const uint32_t frame = capture->frames++;
+
+  if (frame > 0 && memcmp(vram, capture->last, MACHINE_VRAM_SIZE) == 0)
+    return;
+  memcpy(capture->last, vram, MACHINE_VRAM_SIZE);
+  capture->unique_frames++;
+
+  pthread_mutex_lock(&capture->lock);
+  if (capture->head - capture->tail == CAPTURE_QUEUE) {
+    capture->stalls++;
+    while (capture->head - capture->tail == CAPTURE_QUEUE)
+      pthread_cond_wait(&capture->changed, &capture->lock);
+  }
+
+  capture_entry_t* entry = &capture->queue[capture->head % CAPTURE_QUEUE];
+  entry->frame = frame;
+  memcpy(entry->vram, vram, MACHINE_VRAM_SIZE);
+  capture->head++;
+
+  pthread_cond_signal(&capture->changed);
+  pthread_mutex_unlock(&capture->lock);
+}
+
+void destroy_capture(capture_t* capture) {
+  pthread_mutex_lock(&capture->lock);
+  capture->closing = true;
+  pthread_cond_signal(&capture->changed);
+  pthread_mutex_unlock(&capture->lock);
+  pthread_join(capture->thread, NULL);
+
+  if (capture->format == CAPTURE_Y4M)
+    fclose(capture->file);
+  else
+    archive_finish(capture->archive);
+
+  printf("captured %u frames, %u unique, writer stalled %u times\n",
+         capture->frames, capture->unique_frames, capture->stalls);
+
+  pthread_mutex_destroy(&capture->lock);
+  pthread_cond_destroy(&capture->changed);
+  free(capture);
+}
@@ -0,0 +1,540 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "arcade_machine/debug_server.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "i8080/debug.h"
+
+#define DEBUG_SERVER_READ_CHUNK 256
+#define DEBUG_SERVER_ACCEPT_BACKOFF_MS 100  // after accept failed, e.g. EMFILE
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// reads hex digits at *text and advances past them
+static unsigned long parse_hex(const char** text) {
+  unsigned long value = 0;
+  int digit;
+
+  while ((digit = hex_digit(**text)) >= 0) {
+    value = (value << 4) | digit;
+    (*text)++;
+  }
+
+  return value;
+}
+
+static void send_bytes(debug_server_t* server, const char* bytes, size_t size) {
+  pthread_mutex_lock(&server->send_lock);
+  if (server->client_fd >= 0)
+    send(server->client_fd, bytes, size, MSG_NOSIGNAL);
+  pthread_mutex_unlock(&server->send_lock);
+}
+
+static void send_packet(debug_server_t* server, const char* payload) {
+  char packet[DEBUG_SERVER_PACKET_SIZE + 5];
+  uint8_t checksum = 0;
+
+  for (const char* c = payload; *c; c++)
+    checksum += (uint8_t)*c;
+
+  const int length =
+      snprintf(packet, sizeof(packet), "$%s#%02x", payload, checksum);
+  send_bytes(server, packet, length);
+}
+
+static bool has_client(debug_server_t* server) {
+  pthread_mutex_lock(&server->send_lock);
+  const bool connected = server->client_fd >= 0;
+  pthread_mutex_unlock(&server->send_lock);
+
+  return connected;
+}
+
+static bool is_closing(debug_server_t* server) {
+  pthread_mutex_lock(&server->lock);
+  const bool closing = server->closing;
+  pthread_mutex_unlock(&server->lock);
+
+  return closing;
+}
+
+// server thread, waits until the emulation thread took the previous command
+static void post(debug_server_t* server, const char* command) {
+  pthread_mutex_lock(&server->lock);
+  while (server->pending && !server->closing)
+    pthread_cond_wait(&server->changed, &server->lock);
+
+  if (!server->closing) {
+    strcpy(server->command, command);
+    server->pending = true;
+    __atomic_store_n(&server->attention, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&server->changed);
+  }
+  pthread_mutex_unlock(&server->lock);
+}
+
+// splits the byte stream into packets, acknowledging each one
+static void read_packets(debug_server_t* server, int fd) {
+  enum { IDLE, PAYLOAD, CHECKSUM_HIGH, CHECKSUM_LOW } state = IDLE;
+  char packet[DEBUG_SERVER_PACKET_SIZE + 1];
+  size_t length = 0;
+  uint8_t checksum = 0;
+  int expected = 0;
+
+  char chunk[DEBUG_SERVER_READ_CHUNK];
+  ssize_t count;
+  while ((count = read(fd, chunk, sizeof(chunk))) > 0) {
+    for (ssize_t i = 0; i < count; i++) {
+      const char c = chunk[i];
+
+      switch (state) {
+        case IDLE:
+          if (c == '$') {
+            length = 0;
+            checksum = 0;
+            state = PAYLOAD;
+          } else if (c == DEBUG_SERVER_INTERRUPT[0]) {
+            post(server, DEBUG_SERVER_INTERRUPT);
+          }
+          break;
+
+        case PAYLOAD:
+          if (c == '#') {
+            state = CHECKSUM_HIGH;
+          } else {
+            if (length < DEBUG_SERVER_PACKET_SIZE)
+              packet[length++] = c;
+            checksum += (uint8_t)c;
+          }
+          break;
+
+        case CHECKSUM_HIGH:
+          expected = hex_digit(c) << 4;
+          state = CHECKSUM_LOW;
+          break;
+
+        case CHECKSUM_LOW:
+          expected |= hex_digit(c);
+          packet[length] = '\0';
+          state = IDLE;
+
+          if (expected != checksum || length == DEBUG_SERVER_PACKET_SIZE) {
+            send_bytes(server, "-", 1);
+            break;
+          }
+
+          send_bytes(server, "+", 1);
+          post(server, packet);
+          break;
+      }
+    }
+  }
+}
+
+// one client at a time, disconnecting detaches
+static void* listener(void* argument) {
+  debug_server_t* server = argument;
+
+  while (!is_closing(server)) {
+    const int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+      // errors that persist would otherwise spin this thread
+      if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED &&
+          !is_closing(server)) {
+        const struct timespec backoff = {
+            0, DEBUG_SERVER_ACCEPT_BACKOFF_MS * 1000000L};
+        nanosleep(&backoff, NULL);
+      }
+      continue;
+    }
+
+    pthread_mutex_lock(&server->send_lock);
+    server->client_fd = fd;
+    pthread_mutex_unlock(&server->send_lock);
+
+    if (!is_closing(server))
+      read_packets(server, fd);
+
+    pthread_mutex_lock(&server->send_lock);
+    server->client_fd = -1;
+    pthread_mutex_unlock(&server->send_lock);
+    close(fd);
+
+    post(server, DEBUG_SERVER_DETACH);
+  }
+
+  return NULL;
+}
+
+// a socket left by an earlier run is replaced, anything else at path is kept
+static bool remove_stale_socket(const char* path) {
+  struct stat status;
+  if (lstat(path, &status) < 0)
+    return errno == ENOENT;
+
+  if (!S_ISSOCK(status.st_mode)) {
+    printf("Not a socket, refusing to replace: %s\n", path);
+    return false;
+  }
+
+  return unlink(path) == 0;
+}
+
+debug_server_t* create_debug_server(const char* path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    printf("Debug server path too long: %s\n", path);
+    return NULL;
+  }
+  strcpy(address.sun_path, path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    printf("Could not create debug server socket\n");
+    return NULL;
+  }
+
+  if (!remove_stale_socket(path)) {
+    close(fd);
+    return NULL;
+  }
+
+  if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+      listen(fd, 1) < 0) {
+    printf("Could not listen on %s\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  debug_server_t* server = calloc(1, sizeof(debug_server_t));
+  strcpy(server->path, path);
+  server->listen_fd = fd;
+  server->client_fd = -1;
+  server->debug = create_i8080_debug();
+  pthread_mutex_init(&server->send_lock, NULL);
+  pthread_mutex_init(&server->lock, NULL);
+  pthread_cond_init(&server->changed, NULL);
+  pthread_create(&server->thread, NULL, listener, server);
+
+  return server;
+}
+
+void destroy_debug_server(debug_server_t* server) {
+  debug_server_shutdown(server);
+
+  close(server->listen_fd);
+  unlink(server->path);
+  pthread_cond_destroy(&server->changed);
+  pthread_mutex_destroy(&server->lock);
+  pthread_mutex_destroy(&server->send_lock);
+  destroy_i8080_debug(server->debug);
+  free(server);
+}
+
+void debug_server_shutdown(debug_server_t* server) {
+  pthread_mutex_lock(&server->lock);
+  const bool closing = server->closing;
+  server->closing = true;
+  pthread_cond_broadcast(&server->changed);
+  pthread_mutex_unlock(&server->lock);
+
+  if (closing)
+    return;
+
+  // wakes accept and read in the server thread
+  shutdown(server->listen_fd, SHUT_RDWR);
+  pthread_mutex_lock(&server->send_lock);
+  if (server->client_fd >= 0)
+    shutdown(server->client_fd, SHUT_RDWR);
+  pthread_mutex_unlock(&server->send_lock);
+
+  pthread_join(server->thread, NULL);
+}
+
+static void send_stop_reply(debug_server_t* server,
+                            const i8080_debug_t* debug) {
+  char reply[32];
+
+  if (debug->stop == I8080_DEBUG_STOP_WRITE)
+    snprintf(reply, sizeof(reply), "T05watch:%04x;", debug->stop_address);
+  else if (debug->stop == I8080_DEBUG_STOP_READ)
+    snprintf(reply, sizeof(reply), "T05rwatch:%04x;", debug->stop_address);
+  else
+    snprintf(reply, sizeof(reply), "S%02x", server->interrupted ? 2 : 5);
+
+  send_packet(server, reply);
+}
+
+static uint8_t psw_flags(const conditionbits_t* cb) {
+  return cb->flags.s << 7 | cb->flags.z << 6 | cb->flags.ac << 4 |
+         cb->flags.p << 2 | 1 << 1 | cb->flags.c;
+}
+
+static void read_registers(const i8080_t* cpu, char* reply) {
+  sprintf(reply, "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x", cpu->a,
+          psw_flags(&cpu->cb), cpu->b, cpu->c, cpu->d, cpu->e, cpu->h, cpu->l,
+          cpu->sp & 0xff, cpu->sp >> 8, cpu->pc & 0xff, cpu->pc >> 8);
+}
+
+static bool write_registers(i8080_t* cpu, const char* text) {
+  uint8_t bytes[12];
+
+  for (int i = 0; i < 12; i++) {
+    const int high = hex_digit(text[2 * i]);
+    const int low = high < 0 ? -1 : hex_digit(text[2 * i + 1]);
+    if (low < 0)
+      return false;
+    bytes[i] = high << 4 | low;
+  }
+
+  cpu->a = bytes[0];
+  cpu->cb.flags.s = bytes[1] >> 7;
+  cpu->cb.flags.z = bytes[1] >> 6;
+  cpu->cb.flags.ac = bytes[1] >> 4;
+  cpu->cb.flags.p = bytes[1] >> 2;
+  cpu->cb.flags.c = bytes[1];
+  cpu->b = bytes[2];
+  cpu->c = bytes[3];
+  cpu->d = bytes[4];
+  cpu->e = bytes[5];
+  cpu->h = bytes[6];
+  cpu->l = bytes[7];
+  cpu->sp = bytes[8] | bytes[9] << 8;
+  cpu->pc = bytes[10] | bytes[11] << 8;
+  return true;
+}
+
+// m addr,length
+static bool read_memory(const machine_t* machine,
+                        const char* text,
+                        char* reply) {
+  const uint16_t address = parse_hex(&text);
+  if (*text++ != ',')
+    return false;
+
+  const unsigned long length = parse_hex(&text);
+  if (length > DEBUG_SERVER_PACKET_SIZE / 2)
+    return false;
+
+  for (unsigned long i = 0; i < length; i++)
+    sprintf(&reply[2 * i], "%02x",
+            machine->memory[(uint16_t)(address + i)]);
+  reply[2 * length] = '\0';
+  return true;
+}
+
+// M addr,length:data
+static bool write_memory(machine_t* machine, const char* text) {
+  const uint16_t address = parse_hex(&text);
+  if (*text++ != ',')
+    return false;
+
+  const unsigned long length = parse_hex(&text);
+  if (*text++ != ':' || strlen(text) != 2 * length)
+    return false;
+
+  for (unsigned long i = 0; i < length; i++) {
+    const int high = hex_digit(text[2 * i]);
+    const int low = hex_digit(text[2 * i + 1]);
+    if (high < 0 || low < 0)
+      return false;
+    machine->memory[(uint16_t)(address + i)] = high << 4 | low;
+  }
+
+  return true;
+}
+
+// Z type,addr,kind and z type,addr,kind
+static bool set_breakpoint(i8080_debug_t* debug, const char* text, bool set) {
+  static const uint8_t FLAGS[] = {
+      I8080_DEBUG_BREAK, I8080_DEBUG_BREAK, I8080_DEBUG_WRITE,
+      I8080_DEBUG_READ,  I8080_DEBUG_READ | I8080_DEBUG_WRITE,
+  };
+
+  const unsigned long type = parse_hex(&text);
+  if (type >= sizeof(FLAGS) || *text++ != ',')
+    return false;
+
+  const uint16_t address = parse_hex(&text);
+  if (set)
+    i8080_debug_set(debug, address, FLAGS[type]);
+  else
+    i8080_debug_clear(debug, address, FLAGS[type]);
+
+  return true;
+}
+
+static void query(debug_server_t* server, const char* command) {
+  char reply[32];
+
+  if (strncmp(command, "qSupported", 10) == 0) {
+    snprintf(reply, sizeof(reply), "PacketSize=%x", DEBUG_SERVER_PACKET_SIZE);
+    send_packet(server, reply);
+  } else if (strcmp(command, "qAttached") == 0) {
+    send_packet(server, "1");
+  } else {
+    send_packet(server, "");
+  }
+}
+
+static void save_state(debug_server_t* server,
+                       machine_t* machine,
+                       const char* command) {
+  if (strcmp(command, "QSaveState") == 0) {
+    machine_save_state(machine, &server->snapshot);
+    server->saved = true;
+    send_packet(server, "OK");
+  } else if (strcmp(command, "QLoadState") == 0 && server->saved) {
+    machine_load_state(machine, &server->snapshot);
+    send_packet(server, "OK");
+  } else {
+    send_packet(server, "E01");
+  }
+}
+
+// breakpoints of a client do not outlive it, the cpu runs without checks again
+static void detach(debug_server_t* server, machine_t* machine) {
+  if (machine->cpu.debug != server->debug)
+    return;
+
+  machine->cpu.debug = NULL;
+  memset(server->debug, 0, sizeof(i8080_debug_t));
+}
+
+static void execute(debug_server_t* server,
+                    machine_t* machine,
+                    const char* command) {
+  i8080_debug_t* debug = machine->cpu.debug;
+  char reply[DEBUG_SERVER_PACKET_SIZE + 1];
+
+  switch (command[0]) {
+    case '\x03':
+      if (server->halted) {
+        send_stop_reply(server, debug);
+      } else {
+        i8080_debug_request_stop(debug);
+        server->interrupted = true;
+      }
+      break;
+    case '?':
+      if (server->halted)
+        send_stop_reply(server, debug);
+      else
+        send_packet(server, "OK");
+      break;
+    case 'g':
+      read_registers(&machine->cpu, reply);
+      send_packet(server, reply);
+      break;
+    case 'G':
+      send_packet(server,
+                  write_registers(&machine->cpu, &command[1]) ? "OK" : "E01");
+      break;
+    case 'm':
+      send_packet(server,
+                  read_memory(machine, &command[1], reply) ? reply : "E01");
+      break;
+    case 'M':
+      send_packet(server, write_memory(machine, &command[1]) ? "OK" : "E01");
+      break;
+    case 'c':
+      // stop reply follows with the next stop
+      server->halted = false;
+      break;
+    case 's':
+      i8080_debug_request_stop(debug);
+      server->halted = false;
+      break;
+    case 'Z':
+    case 'z':
+      send_packet(server, set_breakpoint(debug, &command[1], command[0] == 'Z')
+                              ? "OK"
+                              : "E01");
+      break;
+    case 'Q':
+      save_state(server, machine, command);
+      break;
+    case 'q':
+      query(server, command);
+      break;
+    case 'H':
+      send_packet(server, "OK");
+      break;
+    case 'D':
+      send_packet(server, "OK");
+      server->halted = false;
+      detach(server, machine);
+      break;
+    case 'k':
+      server->halted = false;
+      detach(server, machine);
+      break;
+    default:
+      send_packet(server, "");  // unsupported
+      break;
+  }
+}
+
+// copies the queued command, waiting for one while halted. false when there
+// is nothing to do
+static bool take_command(debug_server_t* server, char* command) {
+  pthread_mutex_lock(&server->lock);
+  while (!server->pending && server->halted && !server->closing)
+    pthread_cond_wait(&server->changed, &server->lock);
+
+  const bool taken = server->pending && !server->closing;
+  if (taken) {
+    strcpy(command, server->command);
+    server->pending = false;
+    __atomic_store_n(&server->attention, 0, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&server->changed);
+  }
+  pthread_mutex_unlock(&server->lock);
+
+  return taken;
+}
+
+void debug_server_service(debug_server_t* server, machine_t* machine) {
+  char command[DEBUG_SERVER_PACKET_SIZE + 1];
+
+  while (take_command(server, command)) {
+    if (!machine->cpu.debug)
+      machine->cpu.debug = server->debug;
+    execute(server, machine, command);
+  }
+}
+
+void debug_server_stopped(debug_server_t* server, machine_t* machine) {
+  i8080_debug_t* debug = machine->cpu.debug;  // a detaching client clears it
+
+  if (has_client(server)) {
+    server->halted = true;
+    send_stop_reply(server, debug);
+
+    debug_server_service(server, machine);
+    server->halted = false;
+    server->interrupted = false;
+  }
+
+  i8080_debug_resume(debug);
+}
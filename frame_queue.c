@@ -0,0 +1,42 @@
+#include "arcade_machine/frame_queue.h"
+
+frame_queue_t* create_frame_queue() {
+  frame_queue_t* queue = calloc(1, sizeof(frame_queue_t));
+
+  queue->back = 0;
+  queue->middle = 1;
+  queue->front = 2;
+
+  return queue;
+}
+
+void destroy_frame_queue(frame_queue_t* queue) {
+  free(queue);
+}
+
+machine_frame_t* frame_queue_back(frame_queue_t* queue) {
+  return &queue->buffers[queue->back];
+}
+
+void frame_queue_publish(frame_queue_t* queue) {
+  queue->numbers[queue->back] = queue->published;
+
+  // release makes the drawn pixels visible to the consumer with the index
+  const int previous = __atomic_exchange_n(
+      &queue->middle, queue->back | FRAME_QUEUE_FRESH, __ATOMIC_ACQ_REL);
+
+  queue->back = previous & ~FRAME_QUEUE_FRESH;
+  queue->published++;
+}
+
+machine_frame_t* frame_queue_acquire(frame_queue_t* queue) {
+  if (!(__atomic_load_n(&queue->middle, __ATOMIC_RELAXED) & FRAME_QUEUE_FRESH))
+    return NULL;
+
+  const int previous =
+      __atomic_exchange_n(&queue->middle, queue->front, __ATOMIC_ACQ_REL);
+
+  queue->front = previous & ~FRAME_QUEUE_FRESH;
+  queue->presented++;
+  return &queue->buffers[queue->front];
+}
@@ -0,0 +1,78 @@
+// runs the cpu test roms headless and reports emulation speed
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "i8080/testrom.h"
+
+static double seconds_between(const struct timespec* start,
+                              const struct timespec* end) {
+  return (end->tv_sec - start->tv_sec) +
+         (end->tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+int main(int argc, char* argv[]) {
+  bool verbose = false;
+  const char* only = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--verbose") == 0)
+      verbose = true;
+    else if (argv[i][0] != '-' && !only)
+      only = argv[i];
+    else {
+      printf("usage: %s [--verbose] [rom]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  i8080_t state;
+  init_i8080(&state);
+  state.external_memory = malloc(I8080_MAX_MEMORY);
+  testrom_result_t* result = malloc(sizeof(testrom_result_t));
+
+  printf("%-20s %-6s %10s %14s %10s %10s\n", "rom", "result", "time (s)",
+         "instructions", "MIPS", "MHz");
+
+  int failures = 0;
+  double total_seconds = 0;
+  uint64_t total_cycles = 0;
+
+  for (size_t i = 0; i < TESTROM_SUITE_SIZE; i++) {
+    const testrom_t* rom = &TESTROM_SUITE[i];
+    if (only && !strstr(rom->file_name, only))
+      continue;
+
+    testrom_load(&state, rom->file_name);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    testrom_run(&state, result, UINT64_MAX, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double seconds = seconds_between(&start, &end);
+    const bool ok = testrom_passed(rom, result);
+    failures += !ok;
+    total_seconds += seconds;
+    total_cycles += result->cycles;
+
+    printf("%-20s %-6s %10.3f %14" PRIu64 " %10.2f %10.2f\n", rom->file_name,
+           ok ? "PASS" : "FAIL", seconds, result->instructions,
+           result->instructions / seconds / 1e6,
+           result->cycles / seconds / 1e6);
+
+    if (verbose || !ok)
+      printf("%s\n", result->output);
+  }
+
+  if (total_seconds > 0)
+    printf("total %.3f s, %.2f emulated MHz\n", total_seconds,
+           total_cycles / total_seconds / 1e6);
+
+  free(result);
+  free(state.external_memory);
+  return failures ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,307 @@
+#include "i8080/debug.h"
+
+#include <stdlib.h>
+
+// condition encoded in bits 3-5 of conditional calls and returns:
+// NZ, Z, NC, C, PO, PE, P, M
+static bool condition_met(const i8080_t* state, uint8_t opcode) {
+  const conditionbits_t* cb = &state->cb;
+
+  switch ((opcode >> 3) & 7) {
+    case 0:
+      return !cb->flags.z;
+    case 1:
+      return cb->flags.z;
+    case 2:
+      return !cb->flags.c;
+    case 3:
+      return cb->flags.c;
+    case 4:
+      return !cb->flags.p;
+    case 5:
+      return cb->flags.p;
+    case 6:
+      return !cb->flags.s;
+    default:
+      return cb->flags.s;
+  }
+}
+
+static int add_access(i8080_access_t* accesses,
+                      int count,
+                      uint16_t address,
+                      uint8_t flags) {
+  accesses[count].address = address;
+  accesses[count].flags = flags;
+  return count + 1;
+}
+
+// two bytes at address, low byte first
+static int add_word(i8080_access_t* accesses,
+                    int count,
+                    uint16_t address,
+                    uint8_t flags) {
+  count = add_access(accesses, count, address, flags);
+  return add_access(accesses, count, address + 1, flags);
+}
+
+// immediate address of SHLD, LHLD, STA and LDA, wraps at the end of memory
+static uint16_t read_operand(const i8080_t* state) {
+  const uint8_t* memory = state->external_memory;
+  return (memory[(state->pc + 2) & 0xffff] << 8) |
+         memory[(state->pc + 1) & 0xffff];
+}
+
+int i8080_accesses(const i8080_t* state, i8080_access_t* accesses) {
+  const uint8_t* opcode = &state->external_memory[state->pc];
+  const uint16_t operand = read_operand(state);
+  const uint16_t bc = (state->b << 8) | state->c;
+  const uint16_t de = (state->d << 8) | state->e;
+  const uint16_t hl = (state->h << 8) | state->l;
+  const uint16_t sp = state->sp;
+
+  switch (*opcode) {
+    case 0x02:  // STAX B
+      return add_access(accesses, 0, bc, I8080_DEBUG_WRITE);
+    case 0x12:  // STAX D
+      return add_access(accesses, 0, de, I8080_DEBUG_WRITE);
+    case 0x0a:  // LDAX B
+      return add_access(accesses, 0, bc, I8080_DEBUG_READ);
+    case 0x1a:  // LDAX D
+      return add_access(accesses, 0, de, I8080_DEBUG_READ);
+    case 0x22:  // SHLD
+      return add_word(accesses, 0, operand, I8080_DEBUG_WRITE);
+    case 0x2a:  // LHLD
+      return add_word(accesses, 0, operand, I8080_DEBUG_READ);
+    case 0x32:  // STA
+      return add_access(accesses, 0, operand, I8080_DEBUG_WRITE);
+    case 0x3a:  // LDA
+      return add_access(accesses, 0, operand, I8080_DEBUG_READ);
+    case 0x34:  // INR M
+    case 0x35:  // DCR M
+      return add_access(accesses, 0, hl,
+                        I8080_DEBUG_READ | I8080_DEBUG_WRITE);
+    case 0x36:  // MVI M
+      return add_access(accesses, 0, hl, I8080_DEBUG_WRITE);
+    case 0x76:  // HLT
+      return 0;
+    case 0xe3:  // XTHL
+      return add_word(accesses, 0, sp, I8080_DEBUG_READ | I8080_DEBUG_WRITE);
+  }
+
+  // MOV M,r
+  if ((*opcode & 0xf8) == 0x70)
+    return add_access(accesses, 0, hl, I8080_DEBUG_WRITE);
+
+  // MOV r,M and ADD M to CMP M
+  if (*opcode >= 0x40 && *opcode < 0xc0 && (*opcode & 0x07) == 0x06)
+    return add_access(accesses, 0, hl, I8080_DEBUG_READ);
+
+  // PUSH, CALL and its undocumented aliases, RST
+  if ((*opcode & 0xcf) == 0xc5 || (*opcode & 0xcf) == 0xcd ||
+      (*opcode & 0xc7) == 0xc7 ||
+      ((*opcode & 0xc7) == 0xc4 && condition_met(state, *opcode)))
+    return add_word(accesses, 0, sp - 2, I8080_DEBUG_WRITE);
+
+  // POP, RET and its undocumented alias
+  if ((*opcode & 0xcf) == 0xc1 || (*opcode & 0xef) == 0xc9 ||
+      ((*opcode & 0xc7) == 0xc0 && condition_met(state, *opcode)))
+    return add_word(accesses, 0, sp, I8080_DEBUG_READ);
+
+  return 0;
+}
+
+// where the first accessed address of each opcode comes from, lets
+// i8080_debug_check skip the decode unless it lies on a watched page.
+// conditional calls and returns are listed whether taken or not
+enum {
+  ACCESS_NONE,
+  ACCESS_BC,
+  ACCESS_DE,
+  ACCESS_HL,
+  ACCESS_SP,
+  ACCESS_PUSH,  // sp - 2
+  ACCESS_OPERAND,
+};
+
+static const uint8_t ACCESS_BASE[256] = {
+    [0x02] = ACCESS_BC,      [0x0a] = ACCESS_BC,      // STAX B, LDAX B
+    [0x12] = ACCESS_DE,      [0x1a] = ACCESS_DE,      // STAX D, LDAX D
+    [0x22] = ACCESS_OPERAND, [0x2a] = ACCESS_OPERAND,  // SHLD, LHLD
+    [0x32] = ACCESS_OPERAND, [0x3a] = ACCESS_OPERAND,  // STA, LDA
+    [0x34] = ACCESS_HL,      [0x35] = ACCESS_HL,      // INR M, DCR M
+    [0x36] = ACCESS_HL,                               // MVI M
+
+    // MOV r,M
+    [0x46] = ACCESS_HL, [0x4e] = ACCESS_HL, [0x56] = ACCESS_HL,
+    [0x5e] = ACCESS_HL, [0x66] = ACCESS_HL, [0x6e] = ACCESS_HL,
+    [0x7e] = ACCESS_HL,
+
+    // MOV M,r
+    [0x70] = ACCESS_HL, [0x71] = ACCESS_HL, [0x72] = ACCESS_HL,
+    [0x73] = ACCESS_HL, [0x74] = ACCESS_HL, [0x75] = ACCESS_HL,
+    [0x77] = ACCESS_HL,
+
+    // ADD M to CMP M
+    [0x86] = ACCESS_HL, [0x8e] = ACCESS_HL, [0x96] = ACCESS_HL,
+    [0x9e] = ACCESS_HL, [0xa6] = ACCESS_HL, [0xae] = ACCESS_HL,
+    [0xb6] = ACCESS_HL, [0xbe] = ACCESS_HL,
+
+    // POP, RET and its undocumented alias, XTHL
+    [0xc0] = ACCESS_SP, [0xc1] = ACCESS_SP, [0xc8] = ACCESS_SP,
+    [0xc9] = ACCESS_SP, [0xd0] = ACCESS_SP, [0xd1] = ACCESS_SP,
+    [0xd8] = ACCESS_SP, [0xd9] = ACCESS_SP, [0xe0] = ACCESS_SP,
+    [0xe1] = ACCESS_SP, [0xe3] = ACCESS_SP, [0xe8] = ACCESS_SP,
+    [0xf0] = ACCESS_SP, [0xf1] = ACCESS_SP, [0xf8] = ACCESS_SP,
+
+    // PUSH, CALL and its undocumented aliases, RST
+    [0xc4] = ACCESS_PUSH, [0xc5] = ACCESS_PUSH, [0xc7] = ACCESS_PUSH,
+    [0xcc] = ACCESS_PUSH, [0xcd] = ACCESS_PUSH, [0xcf] = ACCESS_PUSH,
+    [0xd4] = ACCESS_PUSH, [0xd5] = ACCESS_PUSH, [0xd7] = ACCESS_PUSH,
+    [0xdc] = ACCESS_PUSH, [0xdd] = ACCESS_PUSH, [0xdf] = ACCESS_PUSH,
+    [0xe4] = ACCESS_PUSH, [0xe5] = ACCESS_PUSH, [0xe7] = ACCESS_PUSH,
+    [0xec] = ACCESS_PUSH, [0xed] = ACCESS_PUSH, [0xef] = ACCESS_PUSH,
+    [0xf4] = ACCESS_PUSH, [0xf5] = ACCESS_PUSH, [0xf7] = ACCESS_PUSH,
+    [0xfc] = ACCESS_PUSH, [0xfd] = ACCESS_PUSH, [0xff] = ACCESS_PUSH,
+};
+
+// true when the instruction at pc may access a page with a watchpoint.
+// accesses are one byte or two consecutive ones, so both pages are checked
+static bool may_hit_watchpoint(const i8080_debug_t* debug,
+                               const i8080_t* state) {
+  uint16_t address;
+
+  switch (ACCESS_BASE[state->external_memory[state->pc]]) {
+    case ACCESS_BC:
+      address = (state->b << 8) | state->c;
+      break;
+    case ACCESS_DE:
+      address = (state->d << 8) | state->e;
+      break;
+    case ACCESS_HL:
+      address = (state->h << 8) | state->l;
+      break;
+    case ACCESS_SP:
+      address = state->sp;
+      break;
+    case ACCESS_PUSH:
+      address = state->sp - 2;
+      break;
+    case ACCESS_OPERAND:
+      address = read_operand(state);
+      break;
+    default:
+      return false;
+  }
+
+  const uint8_t watch = I8080_DEBUG_READ | I8080_DEBUG_WRITE;
+  return (debug->pages[address >> 8] |
+          debug->pages[(uint16_t)(address + 1) >> 8]) &
+         watch;
+}
+
+i8080_debug_t* create_i8080_debug(void) {
+  return calloc(1, sizeof(i8080_debug_t));
+}
+
+void destroy_i8080_debug(i8080_debug_t* debug) {
+  free(debug);
+}
+
+static void update_page(i8080_debug_t* debug, uint16_t address) {
+  const uint16_t start = address & 0xff00;
+  uint8_t flags = 0;
+
+  for (int i = 0; i < I8080_DEBUG_PAGES; i++)
+    flags |= debug->flags[start + i];
+
+  debug->pages[address >> 8] = flags;
+}
+
+static void set_flags(i8080_debug_t* debug, uint16_t address, uint8_t flags) {
+  const uint8_t watch = I8080_DEBUG_READ | I8080_DEBUG_WRITE;
+  const bool watched = debug->flags[address] & watch;
+
+  debug->flags[address] = flags;
+  debug->watchpoints += (bool)(flags & watch) - watched;
+  update_page(debug, address);
+}
+
+void i8080_debug_set(i8080_debug_t* debug, uint16_t address, uint8_t flags) {
+  set_flags(debug, address, debug->flags[address] | flags);
+}
+
+void i8080_debug_clear(i8080_debug_t* debug, uint16_t address, uint8_t flags) {
+  set_flags(debug, address, debug->flags[address] & ~flags);
+}
+
+static bool stop(i8080_debug_t* debug,
+                 i8080_debug_stop_t reason,
+                 uint16_t address) {
+  debug->stop = reason;
+  debug->stop_address = address;
+  return true;
+}
+
+bool i8080_debug_check(i8080_debug_t* debug, const i8080_t* state) {
+  if (debug->resuming) {
+    debug->resuming = false;
+    return false;
+  }
+
+  if (debug->stop_requested) {
+    debug->stop_requested = false;
+    return stop(debug, I8080_DEBUG_STOP_REQUEST, state->pc);
+  }
+
+  if ((debug->pages[state->pc >> 8] & I8080_DEBUG_BREAK) &&
+      (debug->flags[state->pc] & I8080_DEBUG_BREAK))
+    return stop(debug, I8080_DEBUG_STOP_BREAK, state->pc);
+
+  if (debug->watchpoints == 0 || !may_hit_watchpoint(debug, state))
+    return false;
+
+  i8080_access_t accesses[I8080_DEBUG_ACCESSES];
+  const int count = i8080_accesses(state, accesses);
+
+  for (int i = 0; i < count; i++) {
+    const uint16_t address = accesses[i].address;
+    const uint8_t flags = accesses[i].flags;
+
+    // exact address only looked up on flagged pages
+    if (!(debug->pages[address >> 8] & flags))
+      continue;
+
+    const uint8_t hit = debug->flags[address] & flags;
+    if (hit & I8080_DEBUG_WRITE)
+      return stop(debug, I8080_DEBUG_STOP_WRITE, address);
+    if (hit & I8080_DEBUG_READ)
+      return stop(debug, I8080_DEBUG_STOP_READ, address);
+  }
+
+  return false;
+}
+
+void i8080_debug_resume(i8080_debug_t* debug) {
+  debug->stop = I8080_DEBUG_RUNNING;
+  debug->resuming = true;
+}
+
+void i8080_debug_request_stop(i8080_debug_t* debug) {
+  debug->stop_requested = true;
+}
+
+const char* i8080_debug_stop_name(i8080_debug_stop_t stop) {
+  switch (stop) {
+    case I8080_DEBUG_STOP_BREAK:
+      return "breakpoint";
+    case I8080_DEBUG_STOP_READ:
+      return "read watchpoint";
+    case I8080_DEBUG_STOP_WRITE:
+      return "write watchpoint";
+    case I8080_DEBUG_STOP_REQUEST:
+      return "stop";
+    default:
+      return "running";
+  }
+}
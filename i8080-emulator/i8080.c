@@ -1,27 +1,271 @@
 #include "i8080/i8080.h"
+#include "i8080/debug.h"
+#include "i8080/profile.h"
+#include "i8080/trace.h"
 
-// table represents cpu cycles taken by each instruction
+#include <inttypes.h>
+
+// opcode metadata used by i8080_step for cycles and by the disassembler.
 // duration of conditional calls and returns is different
 // when action is taken or not, so remainder is added in individual functions
-static const uint8_t OPCODE_CYCLES[] = {
-    //  0   1   2   3   4   5   6   7   8   9   a	b	c	d
-    //  e	f
-    4, 10, 7,  5,  5,  5,  7,  4,  4, 10, 7,  5,  5,  5,  7, 4,   // 0
-    4, 10, 7,  5,  5,  5,  7,  4,  4, 10, 7,  5,  5,  5,  7, 4,   // 1
-    4, 10, 16, 5,  5,  5,  7,  4,  4, 10, 16, 5,  5,  5,  7, 4,   // 2
-    4, 10, 13, 5,  10, 10, 10, 4,  4, 10, 13, 5,  5,  5,  7, 4,   // 3
-    5, 5,  5,  5,  5,  5,  7,  5,  5, 5,  5,  5,  5,  5,  7, 5,   // 4
-    5, 5,  5,  5,  5,  5,  7,  5,  5, 5,  5,  5,  5,  5,  7, 5,   // 5
-    5, 5,  5,  5,  5,  5,  7,  5,  5, 5,  5,  5,  5,  5,  7, 5,   // 6
-    7, 7,  7,  7,  7,  7,  7,  7,  5, 5,  5,  5,  5,  5,  7, 5,   // 7
-    4, 4,  4,  4,  4,  4,  7,  4,  4, 4,  4,  4,  4,  4,  7, 4,   // 8
-    4, 4,  4,  4,  4,  4,  7,  4,  4, 4,  4,  4,  4,  4,  7, 4,   // 9
-    4, 4,  4,  4,  4,  4,  7,  4,  4, 4,  4,  4,  4,  4,  7, 4,   // a
-    4, 4,  4,  4,  4,  4,  7,  4,  4, 4,  4,  4,  4,  4,  7, 4,   // b
-    5, 10, 10, 10, 11, 11, 7,  11, 5, 10, 10, 10, 11, 17, 7, 11,  // c
-    5, 10, 10, 10, 11, 11, 7,  11, 5, 10, 10, 10, 11, 17, 7, 11,  // d
-    5, 10, 10, 18, 11, 11, 7,  11, 5, 5,  10, 5,  11, 17, 7, 11,  // e
-    5, 10, 10, 4,  11, 11, 7,  11, 5, 5,  10, 4,  11, 17, 7, 11   // f
+const i8080_opcode_t I8080_OPCODES[256] = {
+    // mnemonic, operands, length, cycles
+    {"NOP", "", 1, 4},       // 00
+    {"LXI", "B,#$", 3, 10},  // 01
+    {"STAX", "B", 1, 7},     // 02
+    {"INX", "B", 1, 5},      // 03
+    {"INR", "B", 1, 5},      // 04
+    {"DCR", "B", 1, 5},      // 05
+    {"MVI", "B,#$", 2, 7},   // 06
+    {"RLC", "", 1, 4},       // 07
+    {"NOP", "", 1, 4},       // 08
+    {"DAD", "B", 1, 10},     // 09
+    {"LDAX", "B", 1, 7},     // 0a
+    {"DCX", "B", 1, 5},      // 0b
+    {"INR", "C", 1, 5},      // 0c
+    {"DCR", "C", 1, 5},      // 0d
+    {"MVI", "C,#$", 2, 7},   // 0e
+    {"RRC", "", 1, 4},       // 0f
+    {"NOP", "", 1, 4},       // 10
+    {"LXI", "D,#$", 3, 10},  // 11
+    {"STAX", "D", 1, 7},     // 12
+    {"INX", "D", 1, 5},      // 13
+    {"INR", "D", 1, 5},      // 14
+    {"DCR", "D", 1, 5},      // 15
+    {"MVI", "D,#$", 2, 7},   // 16
+    {"RAL", "", 1, 4},       // 17
+    {"NOP", "", 1, 4},       // 18
+    {"DAD", "D", 1, 10},     // 19
+    {"LDAX", "D", 1, 7},     // 1a
+    {"DCX", "D", 1, 5},      // 1b
+    {"INR", "E", 1, 5},      // 1c
+    {"DCR", "E", 1, 5},      // 1d
+    {"MVI", "E,#$", 2, 7},   // 1e
+    {"RAR", "", 1, 4},       // 1f
+    {"NOP", "", 1, 4},       // 20
+    {"LXI", "H,#$", 3, 10},  // 21
+    {"SHLD", "$", 3, 16},    // 22
+    {"INX", "H", 1, 5},      // 23
+    {"INR", "H", 1, 5},      // 24
+    {"DCR", "H", 1, 5},      // 25
+    {"MVI", "H,#$", 2, 7},   // 26
+    {"DAA", "", 1, 4},       // 27
+    {"NOP", "", 1, 4},       // 28
+    {"DAD", "H", 1, 10},     // 29
+    {"LHLD", "$", 3, 16},    // 2a
+    {"DCX", "H", 1, 5},      // 2b
+    {"INR", "L", 1, 5},      // 2c
+    {"DCR", "L", 1, 5},      // 2d
+    {"MVI", "L,#$", 2, 7},   // 2e
+    {"CMA", "", 1, 4},       // 2f
+    {"NOP", "", 1, 4},       // 30
+    {"LXI", "SP,#$", 3, 10}, // 31
+    {"STA", "$", 3, 13},     // 32
+    {"INX", "SP", 1, 5},     // 33
+    {"INR", "M", 1, 10},     // 34
+    {"DCR", "M", 1, 10},     // 35
+    {"MVI", "M,#$", 2, 10},  // 36
+    {"STC", "", 1, 4},       // 37
+    {"NOP", "", 1, 4},       // 38
+    {"DAD", "SP", 1, 10},    // 39
+    {"LDA", "$", 3, 13},     // 3a
+    {"DCX", "SP", 1, 5},     // 3b
+    {"INR", "A", 1, 5},      // 3c
+    {"DCR", "A", 1, 5},      // 3d
+    {"MVI", "A,#$", 2, 7},   // 3e
+    {"CMC", "", 1, 4},       // 3f
+    {"MOV", "B,B", 1, 5},    // 40
+    {"MOV", "B,C", 1, 5},    // 41
+    {"MOV", "B,D", 1, 5},    // 42
+    {"MOV", "B,E", 1, 5},    // 43
+    {"MOV", "B,H", 1, 5},    // 44
+    {"MOV", "B,L", 1, 5},    // 45
+    {"MOV", "B,M", 1, 7},    // 46
+    {"MOV", "B,A", 1, 5},    // 47
+    {"MOV", "C,B", 1, 5},    // 48
+    {"MOV", "C,C", 1, 5},    // 49
+    {"MOV", "C,D", 1, 5},    // 4a
+    {"MOV", "C,E", 1, 5},    // 4b
+    {"MOV", "C,H", 1, 5},    // 4c
+    {"MOV", "C,L", 1, 5},    // 4d
+    {"MOV", "C,M", 1, 7},    // 4e
+    {"MOV", "C,A", 1, 5},    // 4f
+    {"MOV", "D,B", 1, 5},    // 50
+    {"MOV", "D,C", 1, 5},    // 51
+    {"MOV", "D,D", 1, 5},    // 52
+    {"MOV", "D,E", 1, 5},    // 53
+    {"MOV", "D,H", 1, 5},    // 54
+    {"MOV", "D,L", 1, 5},    // 55
+    {"MOV", "D,M", 1, 7},    // 56
+    {"MOV", "D,A", 1, 5},    // 57
+    {"MOV", "E,B", 1, 5},    // 58
+    {"MOV", "E,C", 1, 5},    // 59
+    {"MOV", "E,D", 1, 5},    // 5a
+    {"MOV", "E,E", 1, 5},    // 5b
+    {"MOV", "E,H", 1, 5},    // 5c
+    {"MOV", "E,L", 1, 5},    // 5d
+    {"MOV", "E,M", 1, 7},    // 5e
+    {"MOV", "E,A", 1, 5},    // 5f
+    {"MOV", "H,B", 1, 5},    // 60
+    {"MOV", "H,C", 1, 5},    // 61
+    {"MOV", "H,D", 1, 5},    // 62
+    {"MOV", "H,E", 1, 5},    // 63
+    {"MOV", "H,H", 1, 5},    // 64
+    {"MOV", "H,L", 1, 5},    // 65
+    {"MOV", "H,M", 1, 7},    // 66
+    {"MOV", "H,A", 1, 5},    // 67
+    {"MOV", "L,B", 1, 5},    // 68
+    {"MOV", "L,C", 1, 5},    // 69
+    {"MOV", "L,D", 1, 5},    // 6a
+    {"MOV", "L,E", 1, 5},    // 6b
+    {"MOV", "L,H", 1, 5},    // 6c
+    {"MOV", "L,L", 1, 5},    // 6d
+    {"MOV", "L,M", 1, 7},    // 6e
+    {"MOV", "L,A", 1, 5},    // 6f
+    {"MOV", "M,B", 1, 7},    // 70
+    {"MOV", "M,C", 1, 7},    // 71
+    {"MOV", "M,D", 1, 7},    // 72
+    {"MOV", "M,E", 1, 7},    // 73
+    {"MOV", "M,H", 1, 7},    // 74
+    {"MOV", "M,L", 1, 7},    // 75
+    {"HLT", "", 1, 7},       // 76
+    {"MOV", "M,A", 1, 7},    // 77
+    {"MOV", "A,B", 1, 5},    // 78
+    {"MOV", "A,C", 1, 5},    // 79
+    {"MOV", "A,D", 1, 5},    // 7a
+    {"MOV", "A,E", 1, 5},    // 7b
+    {"MOV", "A,H", 1, 5},    // 7c
+    {"MOV", "A,L", 1, 5},    // 7d
+    {"MOV", "A,M", 1, 7},    // 7e
+    {"MOV", "A,A", 1, 5},    // 7f
+    {"ADD", "B", 1, 4},      // 80
+    {"ADD", "C", 1, 4},      // 81
+    {"ADD", "D", 1, 4},      // 82
+    {"ADD", "E", 1, 4},      // 83
+    {"ADD", "H", 1, 4},      // 84
+    {"ADD", "L", 1, 4},      // 85
+    {"ADD", "M", 1, 7},      // 86
+    {"ADD", "A", 1, 4},      // 87
+    {"ADC", "B", 1, 4},      // 88
+    {"ADC", "C", 1, 4},      // 89
+    {"ADC", "D", 1, 4},      // 8a
+    {"ADC", "E", 1, 4},      // 8b
+    {"ADC", "H", 1, 4},      // 8c
+    {"ADC", "L", 1, 4},      // 8d
+    {"ADC", "M", 1, 7},      // 8e
+    {"ADC", "A", 1, 4},      // 8f
+    {"SUB", "B", 1, 4},      // 90
+    {"SUB", "C", 1, 4},      // 91
+    {"SUB", "D", 1, 4},      // 92
+    {"SUB", "E", 1, 4},      // 93
+    {"SUB", "H", 1, 4},      // 94
+    {"SUB", "L", 1, 4},      // 95
+    {"SUB", "M", 1, 7},      // 96
+    {"SUB", "A", 1, 4},      // 97
+    {"SBB", "B", 1, 4},      // 98
+    {"SBB", "C", 1, 4},      // 99
+    {"SBB", "D", 1, 4},      // 9a
+    {"SBB", "E", 1, 4},      // 9b
+    {"SBB", "H", 1, 4},      // 9c
+    {"SBB", "L", 1, 4},      // 9d
+    {"SBB", "M", 1, 7},      // 9e
+    {"SBB", "A", 1, 4},      // 9f
+    {"ANA", "B", 1, 4},      // a0
+    {"ANA", "C", 1, 4},      // a1
+    {"ANA", "D", 1, 4},      // a2
+    {"ANA", "E", 1, 4},      // a3
+    {"ANA", "H", 1, 4},      // a4
+    {"ANA", "L", 1, 4},      // a5
+    {"ANA", "M", 1, 7},      // a6
+    {"ANA", "A", 1, 4},      // a7
+    {"XRA", "B", 1, 4},      // a8
+    {"XRA", "C", 1, 4},      // a9
+    {"XRA", "D", 1, 4},      // aa
+    {"XRA", "E", 1, 4},      // ab
+    {"XRA", "H", 1, 4},      // ac
+    {"XRA", "L", 1, 4},      // ad
+    {"XRA", "M", 1, 7},      // ae
+    {"XRA", "A", 1, 4},      // af
+    {"ORA", "B", 1, 4},      // b0
+    {"ORA", "C", 1, 4},      // b1
+    {"ORA", "D", 1, 4},      // b2
+    {"ORA", "E", 1, 4},      // b3
+    {"ORA", "H", 1, 4},      // b4
+    {"ORA", "L", 1, 4},      // b5
+    {"ORA", "M", 1, 7},      // b6
+    {"ORA", "A", 1, 4},      // b7
+    {"CMP", "B", 1, 4},      // b8
+    {"CMP", "C", 1, 4},      // b9
+    {"CMP", "D", 1, 4},      // ba
+    {"CMP", "E", 1, 4},      // bb
+    {"CMP", "H", 1, 4},      // bc
+    {"CMP", "L", 1, 4},      // bd
+    {"CMP", "M", 1, 7},      // be
+    {"CMP", "A", 1, 4},      // bf
+    {"RNZ", "", 1, 5},       // c0
+    {"POP", "B", 1, 10},     // c1
+    {"JNZ", "$", 3, 10},     // c2
+    {"JMP", "$", 3, 10},     // c3
+    {"CNZ", "$", 3, 11},     // c4
+    {"PUSH", "B", 1, 11},    // c5
+    {"ADI", "#$", 2, 7},     // c6
+    {"RST", "0", 1, 11},     // c7
+    {"RZ", "", 1, 5},        // c8
+    {"RET", "", 1, 10},      // c9
+    {"JZ", "$", 3, 10},      // ca
+    {"JMP", "$", 3, 10},     // cb
+    {"CZ", "$", 3, 11},      // cc
+    {"CALL", "$", 3, 17},    // cd
+    {"ACI", "#$", 2, 7},     // ce
+    {"RST", "1", 1, 11},     // cf
+    {"RNC", "", 1, 5},       // d0
+    {"POP", "D", 1, 10},     // d1
+    {"JNC", "$", 3, 10},     // d2
+    {"OUT", "#$", 2, 10},    // d3
+    {"CNC", "$", 3, 11},     // d4
+    {"PUSH", "D", 1, 11},    // d5
+    {"SUI", "#$", 2, 7},     // d6
+    {"RST", "2", 1, 11},     // d7
+    {"RC", "", 1, 5},        // d8
+    {"RET", "", 1, 10},      // d9
+    {"JC", "$", 3, 10},      // da
+    {"IN", "#$", 2, 10},     // db
+    {"CC", "$", 3, 11},      // dc
+    {"CALL", "$", 3, 17},    // dd
+    {"SBI", "#$", 2, 7},     // de
+    {"RST", "3", 1, 11},     // df
+    {"RPO", "", 1, 5},       // e0
+    {"POP", "H", 1, 10},     // e1
+    {"JPO", "$", 3, 10},     // e2
+    {"XTHL", "", 1, 18},     // e3
+    {"CPO", "$", 3, 11},     // e4
+    {"PUSH", "H", 1, 11},    // e5
+    {"ANI", "#$", 2, 7},     // e6
+    {"RST", "4", 1, 11},     // e7
+    {"RPE", "", 1, 5},       // e8
+    {"PCHL", "", 1, 5},      // e9
+    {"JPE", "$", 3, 10},     // ea
+    {"XCHG", "", 1, 5},      // eb
+    {"CPE", "$", 3, 11},     // ec
+    {"CALL", "$", 3, 17},    // ed
+    {"XRI", "#$", 2, 7},     // ee
+    {"RST", "5", 1, 11},     // ef
+    {"RP", "", 1, 5},        // f0
+    {"POP", "PSW", 1, 10},   // f1
+    {"JP", "$", 3, 10},      // f2
+    {"DI", "", 1, 4},        // f3
+    {"CP", "$", 3, 11},      // f4
+    {"PUSH", "PSW", 1, 11},  // f5
+    {"ORI", "#$", 2, 7},     // f6
+    {"RST", "6", 1, 11},     // f7
+    {"RM", "", 1, 5},        // f8
+    {"SPHL", "", 1, 5},      // f9
+    {"JM", "$", 3, 10},      // fa
+    {"EI", "", 1, 4},        // fb
+    {"CM", "$", 3, 11},      // fc
+    {"CALL", "$", 3, 17},    // fd
+    {"CPI", "#$", 2, 7},     // fe
+    {"RST", "7", 1, 11},     // ff
 };
 
 static uint16_t get_regpair_val(const regpair_t* pair) {
@@ -115,6 +359,12 @@ void init_i8080(i8080_t* state) {
   state->ie = 0;
 
   state->external_memory = NULL;
+  state->in = NULL;
+  state->out = NULL;
+  state->io = NULL;
+  state->trace = NULL;
+  state->profile = NULL;
+  state->debug = NULL;
 }
 
 uint8_t i8080_read_byte(i8080_t* state, const uint16_t address) {
@@ -766,6 +1016,19 @@ void i8080_di(i8080_t* state) {
   state->pc++;
 }
 
+void i8080_in(i8080_t* state, uint8_t port) {
+  state->a = state->in ? state->in(state->io, port) : 0;
+
+  state->pc += 2;
+}
+
+void i8080_out(i8080_t* state, uint8_t port) {
+  if (state->out)
+    state->out(state->io, port, state->a);
+
+  state->pc += 2;
+}
+
 void i8080_step(i8080_t* state) {
   // shorthand identifiers for registers, makes switch more readable
   uint8_t* A = &state->a;
@@ -784,7 +1047,21 @@ void i8080_step(i8080_t* state) {
 
   uint8_t* opcode = &state->external_memory[state->pc];
 
-  state->cycles += OPCODE_CYCLES[*opcode];
+  // stopped before executing, cycles and pc are unchanged
+  if (state->debug && i8080_debug_check(state->debug, state))
+    return;
+
+  if (state->trace)
+    i8080_trace_record(state->trace, state);
+
+#ifdef I8080_PROFILE
+  const uint16_t profile_pc = state->pc;
+  const uint16_t profile_sp = state->sp;
+  const uint8_t profile_opcode = *opcode;
+  const uint64_t profile_cycles = state->cycles;
+#endif
+
+  state->cycles += I8080_OPCODES[*opcode].cycles;
 
   switch (*opcode) {
     case 0x00:
@@ -1434,7 +1711,8 @@ void i8080_step(i8080_t* state) {
       i8080_jnc(state, opcode[1], opcode[2]);
       break;
     case 0xd3:
-      break;  // OUT d8 ---unimplemented (ext. hardware)
+      i8080_out(state, opcode[1]);
+      break;
     case 0xd4:
       i8080_cnc(state, opcode[1], opcode[2]);
       break;
@@ -1457,7 +1735,8 @@ void i8080_step(i8080_t* state) {
       i8080_jc(state, opcode[1], opcode[2]);
       break;
     case 0xdb:
-      break;  // IN d8 ---unimplemented(ext. hardware)
+      i8080_in(state, opcode[1]);
+      break;
     case 0xdc:
       i8080_cc(state, opcode[1], opcode[2]);
       break;
@@ -1569,857 +1848,116 @@ void i8080_step(i8080_t* state) {
       i8080_rst(state, 7);
       break;
   }
+
+#ifdef I8080_PROFILE
+  if (state->profile)
+    i8080_profile_count(state->profile, state, profile_pc, profile_sp,
+                        profile_opcode, state->cycles - profile_cycles);
+#endif
+}
+
+void i8080_decode(const unsigned char* bytes,
+                  const uint16_t address,
+                  i8080_instruction_t* instruction) {
+  const i8080_opcode_t* info = &I8080_OPCODES[bytes[0]];
+
+  instruction->address = address;
+  instruction->opcode = bytes[0];
+  instruction->length = info->length;
+  instruction->cycles = info->cycles;
+  instruction->mnemonic = info->mnemonic;
+  instruction->operands = info->operands;
+
+  if (info->length == 3)
+    instruction->operand = (bytes[2] << 8) | bytes[1];
+  else if (info->length == 2)
+    instruction->operand = bytes[1];
+  else
+    instruction->operand = 0;
+}
+
+int i8080_format_instruction(const i8080_instruction_t* instruction,
+                             char* buffer,
+                             size_t size) {
+  if (instruction->length == 3)
+    return snprintf(buffer, size, "%s\t%s%04x", instruction->mnemonic,
+                    instruction->operands, instruction->operand);
+
+  if (instruction->length == 2)
+    return snprintf(buffer, size, "%s\t%s%02x", instruction->mnemonic,
+                    instruction->operands, instruction->operand);
+
+  if (instruction->operands[0])
+    return snprintf(buffer, size, "%s\t%s", instruction->mnemonic,
+                    instruction->operands);
+
+  return snprintf(buffer, size, "%s", instruction->mnemonic);
+}
+
+// the three bytes an instruction can span, wrapping at the end of memory
+static void fetch_instruction(const unsigned char* buffer,
+                              const uint16_t address,
+                              unsigned char* bytes) {
+  for (int i = 0; i < 3; i++)
+    bytes[i] = buffer[(address + i) & 0xffff];
+}
+
+uint8_t i8080_disassemble_to(const unsigned char* buffer,
+                             const uint16_t pc,
+                             char* text,
+                             size_t size) {
+  unsigned char bytes[3];
+  fetch_instruction(buffer, pc, bytes);
+
+  i8080_instruction_t instruction;
+  i8080_decode(bytes, pc, &instruction);
+  i8080_format_instruction(&instruction, text, size);
+
+  return instruction.length;
+}
+
+size_t i8080_disassemble_range(const unsigned char* buffer,
+                               const uint16_t start,
+                               const uint16_t end,
+                               char* text,
+                               size_t size) {
+  size_t used = 0;
+  uint32_t pc = start;
+
+  while (pc < end) {
+    unsigned char bytes[3];
+    fetch_instruction(buffer, pc, bytes);
+
+    i8080_instruction_t instruction;
+    i8080_decode(bytes, pc, &instruction);
+
+    char line[I8080_DISASSEMBLY_LENGTH];
+    i8080_format_instruction(&instruction, line, sizeof(line));
+
+    const bool fits = used < size;
+    const int length = snprintf(fits ? text + used : NULL,
+                                fits ? size - used : 0, "%04x %s\n",
+                                (unsigned)pc, line);
+    used += length;
+    pc += instruction.length;
+  }
+
+  return used;
 }
 
 // returns bytes of operation at pc
 uint8_t i8080_disassemble(const unsigned char* buffer, const uint16_t pc) {
-  const unsigned char* opcode = &buffer[pc];
-
-  uint8_t opbytes = 1;  // default byte length of instructions
-
-  printf("%04x ", pc);
-
-  switch (*opcode) {
-    case 0x00:
-      printf("NOP");
-      break;
-    case 0x01:
-      printf("LXI\tB,#$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x02:
-      printf("STAX\tB");
-      break;
-    case 0x03:
-      printf("INX\tB");
-      break;
-    case 0x04:
-      printf("INR\tB");
-      break;
-    case 0x05:
-      printf("DCR\tB");
-      break;
-    case 0x06:
-      printf("MVI\tB,#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0x07:
-      printf("RLC");
-      break;
-    case 0x08:
-      printf("NOP");
-      break;
-    case 0x09:
-      printf("DAD\tB");
-      break;
-    case 0x0a:
-      printf("LDAX\tB");
-      break;
-    case 0x0b:
-      printf("DCX\tB");
-      break;
-    case 0x0c:
-      printf("INR\tC");
-      break;
-    case 0x0d:
-      printf("DCR\tC");
-      break;
-    case 0x0e:
-      printf("MVI\tC,#$%02x", opcode[1]);
-      break;
-    case 0x0f:
-      printf("RRC");
-      break;
-
-    case 0x10:
-      printf("NOP");
-      break;
-    case 0x11:
-      printf("LXI\tD,#$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x12:
-      printf("STAX\tD");
-      break;
-    case 0x13:
-      printf("INX\tD");
-      break;
-    case 0x14:
-      printf("INR\tD");
-      break;
-    case 0x15:
-      printf("DCR\tD");
-      break;
-    case 0x16:
-      printf("MVI\tD,#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0x17:
-      printf("RAL");
-      break;
-    case 0x18:
-      printf("NOP");
-      break;
-    case 0x19:
-      printf("DAD\tD");
-      break;
-    case 0x1a:
-      printf("LDAX\tD");
-      break;
-    case 0x1b:
-      printf("DCX\tD");
-      break;
-    case 0x1c:
-      printf("INR\tE");
-      break;
-    case 0x1d:
-      printf("DCR\tE");
-      break;
-    case 0x1e:
-      printf("MVI\tE,#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0x1f:
-      printf("RAR");
-      break;
-
-    case 0x20:
-      printf("NOP");
-      break;
-    case 0x21:
-      printf("LXI\tH,#$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x22:
-      printf("SHLD\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x23:
-      printf("INX\tH");
-      break;
-    case 0x24:
-      printf("INR\tH");
-      break;
-    case 0x25:
-      printf("DCR\tH");
-      break;
-    case 0x26:
-      printf("MVI\tH,#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0x27:
-      printf("DAA");
-      break;
-    case 0x28:
-      printf("NOP");
-      break;
-    case 0x29:
-      printf("DAD\tH");
-      break;
-    case 0x2a:
-      printf("LHLD\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x2b:
-      printf("DCX\tH");
-      break;
-    case 0x2c:
-      printf("INR\tL");
-      break;
-    case 0x2d:
-      printf("DCR\tL");
-      break;
-    case 0x2e:
-      printf("MVI\tL,#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0x2f:
-      printf("CMA");
-      break;
-
-    case 0x30:
-      printf("NOP");
-      break;
-    case 0x31:
-      printf("LXI\tSP,#$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x32:
-      printf("STA\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x33:
-      printf("INX\tSP");
-      break;
-    case 0x34:
-      printf("INR\tM");
-      break;
-    case 0x35:
-      printf("DCR\tM");
-      break;
-    case 0x36:
-      printf("MVI\tM,#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0x37:
-      printf("STC");
-      break;
-    case 0x38:
-      printf("NOP");
-      break;
-    case 0x39:
-      printf("DAD\tSP");
-      break;
-    case 0x3a:
-      printf("LDA\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0x3b:
-      printf("DCX\tSP");
-      break;
-    case 0x3c:
-      printf("INR\tA");
-      break;
-    case 0x3d:
-      printf("DCR\tA");
-      break;
-    case 0x3e:
-      printf("MVI\tA,#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0x3f:
-      printf("CMC");
-      break;
-
-    case 0x40:
-      printf("MOV\tB,B");
-      break;
-    case 0x41:
-      printf("MOV\tB,C");
-      break;
-    case 0x42:
-      printf("MOV\tB,D");
-      break;
-    case 0x43:
-      printf("MOV\tB,E");
-      break;
-    case 0x44:
-      printf("MOV\tB,H");
-      break;
-    case 0x45:
-      printf("MOV\tB,L");
-      break;
-    case 0x46:
-      printf("MOV\tB,M");
-      break;
-    case 0x47:
-      printf("MOV\tB,A");
-      break;
-    case 0x48:
-      printf("MOV\tC,B");
-      break;
-    case 0x49:
-      printf("MOV\tC,C");
-      break;
-    case 0x4a:
-      printf("MOV\tC,D");
-      break;
-    case 0x4b:
-      printf("MOV\tC,E");
-      break;
-    case 0x4c:
-      printf("MOV\tC,H");
-      break;
-    case 0x4d:
-      printf("MOV\tC,L");
-      break;
-    case 0x4e:
-      printf("MOV\tC,M");
-      break;
-    case 0x4f:
-      printf("MOV\tC,A");
-      break;
-
-    case 0x50:
-      printf("MOV\tD,B");
-      break;
-    case 0x51:
-      printf("MOV\tD,C");
-      break;
-    case 0x52:
-      printf("MOV\tD,D");
-      break;
-    case 0x53:
-      printf("MOV\tD.E");
-      break;
-    case 0x54:
-      printf("MOV\tD,H");
-      break;
-    case 0x55:
-      printf("MOV\tD,L");
-      break;
-    case 0x56:
-      printf("MOV\tD,M");
-      break;
-    case 0x57:
-      printf("MOV\tD,A");
-      break;
-    case 0x58:
-      printf("MOV\tE,B");
-      break;
-    case 0x59:
-      printf("MOV\tE,C");
-      break;
-    case 0x5a:
-      printf("MOV\tE,D");
-      break;
-    case 0x5b:
-      printf("MOV\tE,E");
-      break;
-    case 0x5c:
-      printf("MOV\tE,H");
-      break;
-    case 0x5d:
-      printf("MOV\tE,L");
-      break;
-    case 0x5e:
-      printf("MOV\tE,M");
-      break;
-    case 0x5f:
-      printf("MOV\tE,A");
-      break;
-
-    case 0x60:
-      printf("MOV\tH,B");
-      break;
-    case 0x61:
-      printf("MOV\tH,C");
-      break;
-    case 0x62:
-      printf("MOV\tH,D");
-      break;
-    case 0x63:
-      printf("MOV\tH.E");
-      break;
-    case 0x64:
-      printf("MOV\tH,H");
-      break;
-    case 0x65:
-      printf("MOV\tH,L");
-      break;
-    case 0x66:
-      printf("MOV\tH,M");
-      break;
-    case 0x67:
-      printf("MOV\tH,A");
-      break;
-    case 0x68:
-      printf("MOV\tL,B");
-      break;
-    case 0x69:
-      printf("MOV\tL,C");
-      break;
-    case 0x6a:
-      printf("MOV\tL,D");
-      break;
-    case 0x6b:
-      printf("MOV\tL,E");
-      break;
-    case 0x6c:
-      printf("MOV\tL,H");
-      break;
-    case 0x6d:
-      printf("MOV\tL,L");
-      break;
-    case 0x6e:
-      printf("MOV\tL,M");
-      break;
-    case 0x6f:
-      printf("MOV\tL,A");
-      break;
+  char text[I8080_DISASSEMBLY_LENGTH];
+  const uint8_t opbytes = i8080_disassemble_to(buffer, pc, text, sizeof(text));
 
-    case 0x70:
-      printf("MOV\tM,B");
-      break;
-    case 0x71:
-      printf("MOV\tM,C");
-      break;
-    case 0x72:
-      printf("MOV\tM,D");
-      break;
-    case 0x73:
-      printf("MOV\tM.E");
-      break;
-    case 0x74:
-      printf("MOV\tM,H");
-      break;
-    case 0x75:
-      printf("MOV\tM,L");
-      break;
-    case 0x76:
-      printf("HLT");
-      break;
-    case 0x77:
-      printf("MOV\tM,A");
-      break;
-    case 0x78:
-      printf("MOV\tA,B");
-      break;
-    case 0x79:
-      printf("MOV\tA,C");
-      break;
-    case 0x7a:
-      printf("MOV\tA,D");
-      break;
-    case 0x7b:
-      printf("MOV\tA,E");
-      break;
-    case 0x7c:
-      printf("MOV\tA,H");
-      break;
-    case 0x7d:
-      printf("MOV\tA,L");
-      break;
-    case 0x7e:
-      printf("MOV\tA,M");
-      break;
-    case 0x7f:
-      printf("MOV\tA,A");
-      break;
-
-    case 0x80:
-      printf("ADD\tB");
-      break;
-    case 0x81:
-      printf("ADD\tC");
-      break;
-    case 0x82:
-      printf("ADD\tD");
-      break;
-    case 0x83:
-      printf("ADD\tE");
-      break;
-    case 0x84:
-      printf("ADD\tH");
-      break;
-    case 0x85:
-      printf("ADD\tL");
-      break;
-    case 0x86:
-      printf("ADD\tM");
-      break;
-    case 0x87:
-      printf("ADD\tA");
-      break;
-    case 0x88:
-      printf("ADC\tB");
-      break;
-    case 0x89:
-      printf("ADC\tC");
-      break;
-    case 0x8a:
-      printf("ADC\tD");
-      break;
-    case 0x8b:
-      printf("ADC\tE");
-      break;
-    case 0x8c:
-      printf("ADC\tH");
-      break;
-    case 0x8d:
-      printf("ADC\tL");
-      break;
-    case 0x8e:
-      printf("ADC\tM");
-      break;
-    case 0x8f:
-      printf("ADC\tA");
-      break;
-
-    case 0x90:
-      printf("SUB\tB");
-      break;
-    case 0x91:
-      printf("SUB\tC");
-      break;
-    case 0x92:
-      printf("SUB\tD");
-      break;
-    case 0x93:
-      printf("SUB\tE");
-      break;
-    case 0x94:
-      printf("SUB\tH");
-      break;
-    case 0x95:
-      printf("SUB\tL");
-      break;
-    case 0x96:
-      printf("SUB\tM");
-      break;
-    case 0x97:
-      printf("SUB\tA");
-      break;
-    case 0x98:
-      printf("SBB\tB");
-      break;
-    case 0x99:
-      printf("SBB\tC");
-      break;
-    case 0x9a:
-      printf("SBB\tD");
-      break;
-    case 0x9b:
-      printf("SBB\tE");
-      break;
-    case 0x9c:
-      printf("SBB\tH");
-      break;
-    case 0x9d:
-      printf("SBB\tL");
-      break;
-    case 0x9e:
-      printf("SBB\tM");
-      break;
-    case 0x9f:
-      printf("SBB\tA");
-      break;
-
-    case 0xa0:
-      printf("ANA\tB");
-      break;
-    case 0xa1:
-      printf("ANA\tC");
-      break;
-    case 0xa2:
-      printf("ANA\tD");
-      break;
-    case 0xa3:
-      printf("ANA\tE");
-      break;
-    case 0xa4:
-      printf("ANA\tH");
-      break;
-    case 0xa5:
-      printf("ANA\tL");
-      break;
-    case 0xa6:
-      printf("ANA\tM");
-      break;
-    case 0xa7:
-      printf("ANA\tA");
-      break;
-    case 0xa8:
-      printf("XRA\tB");
-      break;
-    case 0xa9:
-      printf("XRA\tC");
-      break;
-    case 0xaa:
-      printf("XRA\tD");
-      break;
-    case 0xab:
-      printf("XRA\tE");
-      break;
-    case 0xac:
-      printf("XRA\tH");
-      break;
-    case 0xad:
-      printf("XRA\tL");
-      break;
-    case 0xae:
-      printf("XRA\tM");
-      break;
-    case 0xaf:
-      printf("XRA\tA");
-      break;
-
-    case 0xb0:
-      printf("ORA\tB");
-      break;
-    case 0xb1:
-      printf("ORA\tC");
-      break;
-    case 0xb2:
-      printf("ORA\tD");
-      break;
-    case 0xb3:
-      printf("ORA\tE");
-      break;
-    case 0xb4:
-      printf("ORA\tH");
-      break;
-    case 0xb5:
-      printf("ORA\tL");
-      break;
-    case 0xb6:
-      printf("ORA\tM");
-      break;
-    case 0xb7:
-      printf("ORA\tA");
-      break;
-    case 0xb8:
-      printf("CMP\tB");
-      break;
-    case 0xb9:
-      printf("CMP\tC");
-      break;
-    case 0xba:
-      printf("CMP\tD");
-      break;
-    case 0xbb:
-      printf("CMP\tE");
-      break;
-    case 0xbc:
-      printf("CMP\tH");
-      break;
-    case 0xbd:
-      printf("CMP\tL");
-      break;
-    case 0xbe:
-      printf("CMP\tM");
-      break;
-    case 0xbf:
-      printf("CMP\tA");
-      break;
-
-    case 0xc0:
-      printf("RNZ");
-      break;
-    case 0xc1:
-      printf("POP\tB");
-      break;
-    case 0xc2:
-      printf("JNZ\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xc3:
-      printf("JMP\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xc4:
-      printf("CNZ\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xc5:
-      printf("PUSH\tB");
-      break;
-    case 0xc6:
-      printf("ADI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xc7:
-      printf("RST\t0");
-      break;
-    case 0xc8:
-      printf("RZ");
-      break;
-    case 0xc9:
-      printf("RET");
-      break;
-    case 0xca:
-      printf("JZ\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xcb:
-      printf("JMP\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xcc:
-      printf("CZ\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xcd:
-      printf("CALL\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xce:
-      printf("ACI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xcf:
-      printf("RST\t1");
-      break;
-
-    case 0xd0:
-      printf("RNC");
-      break;
-    case 0xd1:
-      printf("POP\tD");
-      break;
-    case 0xd2:
-      printf("JNC\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xd3:
-      printf("OUT\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xd4:
-      printf("CNC\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xd5:
-      printf("PUSH\tD");
-      break;
-    case 0xd6:
-      printf("SUI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xd7:
-      printf("RST\t2");
-      break;
-    case 0xd8:
-      printf("RC");
-      break;
-    case 0xd9:
-      printf("RET");
-      break;
-    case 0xda:
-      printf("JC\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xdb:
-      printf("IN\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xdc:
-      printf("CC\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xdd:
-      printf("CALL\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xde:
-      printf("SBI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xdf:
-      printf("RST\t3");
-      break;
-
-    case 0xe0:
-      printf("RPO");
-      break;
-    case 0xe1:
-      printf("POP\tH");
-      break;
-    case 0xe2:
-      printf("JPO\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xe3:
-      printf("XTHL");
-      break;
-    case 0xe4:
-      printf("CPO\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xe5:
-      printf("PUSH\tH");
-      break;
-    case 0xe6:
-      printf("ANI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xe7:
-      printf("RST\t4");
-      break;
-    case 0xe8:
-      printf("RPE");
-      break;
-    case 0xe9:
-      printf("PCHL");
-      break;
-    case 0xea:
-      printf("JPE\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xeb:
-      printf("XCHG");
-      break;
-    case 0xec:
-      printf("CPE\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xed:
-      printf("CALL\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xee:
-      printf("XRI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xef:
-      printf("RST\t5");
-      break;
-
-    case 0xf0:
-      printf("RP");
-      break;
-    case 0xf1:
-      printf("POP\t");
-      break;
-    case 0xf2:
-      printf("JP\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xf3:
-      printf("DI");
-      break;
-    case 0xf4:
-      printf("CP\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xf5:
-      printf("PUSH\t");
-      break;
-    case 0xf6:
-      printf("ORI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xf7:
-      printf("RST\t6");
-      break;
-    case 0xf8:
-      printf("RM");
-      break;
-    case 0xf9:
-      printf("SPHL");
-      break;
-    case 0xfa:
-      printf("JM\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xfb:
-      printf("EI");
-      break;
-    case 0xfc:
-      printf("CM\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xfd:
-      printf("CALL\t$%02x%02x", opcode[2], opcode[1]);
-      opbytes = 3;
-      break;
-    case 0xfe:
-      printf("CPI\t#$%02x", opcode[1]);
-      opbytes = 2;
-      break;
-    case 0xff:
-      printf("RST\t7");
-      break;
-  }
-
-  printf("\n");
+  printf("%04x %s\n", pc, text);
 
   return opbytes;
 }
 
 void i8080_print(i8080_t* state) {
   printf("a\tbc\tde\thl\tpc\tsp\tz s p c (ac)\tcycles\n");
-  printf("%02x\t%02x%02x\t%02x%02x\t%02x%02x\t%04x\t%04x\t%i %i %i %i %i\t%i\n",
+  printf("%02x\t%02x%02x\t%02x%02x\t%02x%02x\t%04x\t%04x\t%i %i %i %i %i\t%" PRIu64 "\n",
          state->a, state->b, state->c,  // registers
          state->d, state->e, state->h, state->l, state->pc, state->sp,
          state->cb.flags.z, state->cb.flags.s,  // flags
@@ -0,0 +1,63 @@
+// breakpoints and memory watchpoints, checked by i8080_step when attached.
+// every 256-byte page keeps the union of the flags of its addresses, so only
+// instructions executing from or accessing a flagged page take the slow path
+#ifndef I8080_DEBUG_H
+#define I8080_DEBUG_H
+
+#include "i8080/i8080.h"
+
+#define I8080_DEBUG_PAGES 256
+#define I8080_DEBUG_BREAK 0x1  // stop before executing address
+#define I8080_DEBUG_READ 0x2   // stop before an instruction reads address
+#define I8080_DEBUG_WRITE 0x4  // stop before an instruction writes address
+#define I8080_DEBUG_ACCESSES 4  // memory accesses of one instruction at most
+
+typedef enum {
+  I8080_DEBUG_RUNNING,
+  I8080_DEBUG_STOP_BREAK,
+  I8080_DEBUG_STOP_READ,
+  I8080_DEBUG_STOP_WRITE,
+  I8080_DEBUG_STOP_REQUEST,  // i8080_debug_request_stop, e.g. single step
+} i8080_debug_stop_t;
+
+typedef struct {
+  uint16_t address;
+  uint8_t flags;  // I8080_DEBUG_READ or I8080_DEBUG_WRITE
+} i8080_access_t;
+
+typedef struct i8080_debug_t {
+  uint8_t flags[I8080_MAX_MEMORY];
+  uint8_t pages[I8080_DEBUG_PAGES];  // union of flags in each page
+  uint32_t watchpoints;  // addresses with read or write flags set
+
+  // set when i8080_step returned without executing, pc is unchanged
+  i8080_debug_stop_t stop;
+  uint16_t stop_address;  // breakpoint pc or watched address
+  bool resuming;  // next instruction runs without checks
+  bool stop_requested;
+} i8080_debug_t;
+
+i8080_debug_t* create_i8080_debug(void);
+void destroy_i8080_debug(i8080_debug_t* debug);
+
+// flags is a combination of I8080_DEBUG_BREAK, _READ and _WRITE
+void i8080_debug_set(i8080_debug_t* debug, uint16_t address, uint8_t flags);
+void i8080_debug_clear(i8080_debug_t* debug, uint16_t address, uint8_t flags);
+
+// returns true when the instruction at pc must not execute, see stop
+bool i8080_debug_check(i8080_debug_t* debug, const i8080_t* state);
+
+// continues after a stop, the instruction at pc executes without stopping
+// again on its own breakpoint or watchpoint
+void i8080_debug_resume(i8080_debug_t* debug);
+
+// stops before the next instruction, not thread safe
+void i8080_debug_request_stop(i8080_debug_t* debug);
+
+// memory the instruction at pc reads or writes, returns count. conditional
+// calls and returns only count when taken, opcode fetch is not included
+int i8080_accesses(const i8080_t* state, i8080_access_t* accesses);
+
+const char* i8080_debug_stop_name(i8080_debug_stop_t stop);
+
+#endif  // I8080_DEBUG_H
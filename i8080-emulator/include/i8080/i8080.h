@@ -2,12 +2,14 @@
 #define I8080_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
 #define I8080_MAX_MEMORY \
   65536  // i8080's stack pointer holds 2 bytes; 2^16 (65536) is the largest
          // number which can be represented by 16 bits
+#define I8080_DISASSEMBLY_LENGTH 32  // buffer size fitting any instruction
 
 // structured according to PSW format
 typedef union {
@@ -27,11 +29,20 @@ typedef union {
 typedef struct i8080_t {
   uint8_t a, b, c, d, e, h, l;  // 7 registers. pairs: PSW, BC, DE, HL
   uint16_t pc, sp;              // program counter, stack pointer
-  uint32_t cycles;              // Hz
+  uint64_t cycles;              // since reset, never wraps or rewinds
   conditionbits_t cb;
   uint8_t ie;  // interrupts enabled
 
   uint8_t* external_memory;
+
+  // external hardware on IN and OUT, IN reads 0 when in is not set
+  uint8_t (*in)(void* io, uint8_t port);
+  void (*out)(void* io, uint8_t port, uint8_t value);
+  void* io;  // passed to the port handlers
+
+  struct i8080_trace_t* trace;  // records every step when set, see trace.h
+  struct i8080_profile_t* profile;  // used by I8080_PROFILE builds, profile.h
+  struct i8080_debug_t* debug;  // breakpoints and watchpoints, see debug.h
 } i8080_t;
 
 typedef struct {
@@ -39,6 +50,27 @@ typedef struct {
   uint8_t* second;
 } regpair_t;
 
+// static description of an opcode, shared by i8080_step and disassembler
+typedef struct {
+  const char* mnemonic;
+  const char* operands;  // register operands and prefix of immediate value
+  uint8_t length;        // bytes including opcode
+  uint8_t cycles;        // untaken duration of conditional calls and returns
+} i8080_opcode_t;
+
+extern const i8080_opcode_t I8080_OPCODES[256];
+
+// instruction decoded at an address
+typedef struct {
+  uint16_t address;
+  uint8_t opcode;
+  uint8_t length;
+  uint8_t cycles;
+  uint16_t operand;  // immediate byte or word, 0 when length is 1
+  const char* mnemonic;
+  const char* operands;
+} i8080_instruction_t;
+
 void init_conditionbits(
     conditionbits_t* cb);  // inits members to 0 except bit1 which is always 1
 void init_i8080(i8080_t* state);
@@ -49,6 +81,25 @@ void i8080_interrupt(
     uint8_t low,
     uint8_t high);  // pushes current pc onto stack and jumps to address
 
+// disassembly, buffer is the memory instructions are read from. i8080_decode
+// reads up to three bytes, the others wrap addresses at the end of memory
+void i8080_decode(const unsigned char* bytes,
+                  const uint16_t address,
+                  i8080_instruction_t* instruction);
+int i8080_format_instruction(const i8080_instruction_t* instruction,
+                             char* buffer,
+                             size_t size);  // snprintf semantics
+uint8_t i8080_disassemble_to(const unsigned char* buffer,
+                             const uint16_t pc,
+                             char* text,
+                             size_t size);  // returns bytes of instruction
+size_t i8080_disassemble_range(
+    const unsigned char* buffer,
+    const uint16_t start,
+    const uint16_t end,
+    char* text,
+    size_t size);  // one line per instruction in [start, end), returns length
+                   // needed like snprintf
 uint8_t i8080_disassemble(const unsigned char* buffer,
                           const uint16_t pc);  // prints assembly from hex
 void i8080_print(i8080_t* state);              // prints state of cpu
@@ -177,4 +228,8 @@ void i8080_rst(i8080_t* state, uint8_t rst_num);
 void i8080_ei(i8080_t* state);
 void i8080_di(i8080_t* state);
 
+// input/output instructions, call the port handlers of the cpu
+void i8080_in(i8080_t* state, uint8_t port);
+void i8080_out(i8080_t* state, uint8_t port);
+
 #endif  // I8080_H
@@ -0,0 +1,58 @@
+// guest profiler, cycles per pc, per opcode and per called subroutine.
+// counting in i8080_step is only compiled in with I8080_PROFILE defined
+#ifndef I8080_PROFILE_H
+#define I8080_PROFILE_H
+
+#include "i8080/i8080.h"
+
+#define I8080_PROFILE_STACK 256  // tracked subroutine nesting
+#define I8080_PROFILE_EDGES 4096  // distinct caller/callee pairs, power of two
+#define I8080_PROFILE_REPORT_LINES 30
+
+typedef struct {
+  uint16_t function;        // entry address of subroutine
+  uint16_t return_address;  // pc expected after RET
+  uint64_t entry_cycles;
+} i8080_profile_frame_t;
+
+typedef struct {
+  uint16_t caller, callee;
+  bool used;
+  uint64_t calls;
+  uint64_t cycles;  // inclusive cycles spent in callee
+} i8080_profile_edge_t;
+
+typedef struct i8080_profile_t {
+  uint64_t total_cycles, total_instructions;
+
+  uint64_t pc_cycles[I8080_MAX_MEMORY];
+  uint64_t pc_count[I8080_MAX_MEMORY];
+  uint64_t opcode_cycles[256];
+  uint64_t opcode_count[256];
+
+  // call graph derived from CALL, RST, RET and interrupts
+  uint64_t function_calls[I8080_MAX_MEMORY];
+  uint64_t function_self_cycles[I8080_MAX_MEMORY];
+  uint64_t function_total_cycles[I8080_MAX_MEMORY];
+  i8080_profile_edge_t edges[I8080_PROFILE_EDGES];
+  i8080_profile_frame_t stack[I8080_PROFILE_STACK];
+  uint32_t depth;
+  uint16_t next_pc, next_sp;  // state following last instruction
+} i8080_profile_t;
+
+i8080_profile_t* create_i8080_profile();
+void destroy_i8080_profile(i8080_profile_t* profile);
+
+// called by i8080_step with state before the instruction executed
+void i8080_profile_count(i8080_profile_t* profile,
+                         const i8080_t* state,
+                         uint16_t pc,
+                         uint16_t sp,
+                         uint8_t opcode,
+                         uint32_t cycles);
+
+// prints hot spots with disassembly of memory, opcodes and call graph
+void i8080_profile_report(const i8080_profile_t* profile,
+                          const unsigned char* memory);
+
+#endif  // I8080_PROFILE_H
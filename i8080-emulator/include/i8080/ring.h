@@ -0,0 +1,15 @@
+// index arithmetic shared by the single producer rings of the trace and the
+// frame timing
+#ifndef I8080_RING_H
+#define I8080_RING_H
+
+#include <stdint.h>
+
+// oldest record a consumer may keep after loading head. the producer writes
+// record head into its slot before publishing head + 1, so the record sharing
+// that slot can be torn
+static inline uint64_t ring_first_valid(uint64_t head, uint64_t capacity) {
+  return head >= capacity ? head - capacity + 1 : 0;
+}
+
+#endif  // I8080_RING_H
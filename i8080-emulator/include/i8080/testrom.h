@@ -0,0 +1,44 @@
+// runs CP/M test roms headless, BDOS console output is captured
+#ifndef I8080_TESTROM_H
+#define I8080_TESTROM_H
+
+#include "i8080/i8080.h"
+
+#define TESTROM_OUTPUT_SIZE 8192
+#define TESTROM_LOAD_ADDRESS 0x100
+#define TESTROM_BDOS_ADDRESS 0x5
+#define TESTROM_CANCEL_INTERVAL (1 << 16)  // instructions between checks
+
+typedef struct {
+  const char* file_name;
+  const char* pass;  // expected in output, any "ERROR" fails the rom
+} testrom_t;
+
+// TST8080, CPUTEST, 8080PRE and 8080EXM, relative to i8080-emulator
+extern const testrom_t TESTROM_SUITE[];
+extern const size_t TESTROM_SUITE_SIZE;
+
+typedef struct {
+  char output[TESTROM_OUTPUT_SIZE];  // null terminated, truncated when full
+  size_t output_length;
+
+  uint64_t instructions;
+  uint64_t cycles;
+  bool finished;  // jumped to 0x0000, warm boot
+  bool halted;    // reached HLT
+  bool cancelled;
+} testrom_result_t;
+
+// clears memory, loads file at 0x100 and resets cpu to start there
+void testrom_load(i8080_t* state, const char* file_name);
+
+// runs until warm boot, HLT, max_instructions were executed or cancel is set
+// non-zero by another thread. cancel may be NULL
+void testrom_run(i8080_t* state,
+                 testrom_result_t* result,
+                 uint64_t max_instructions,
+                 const int* cancel);
+
+bool testrom_passed(const testrom_t* rom, const testrom_result_t* result);
+
+#endif  // I8080_TESTROM_H
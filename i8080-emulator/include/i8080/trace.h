@@ -0,0 +1,53 @@
+// ring buffer of executed instructions, filled by i8080_step when attached
+#ifndef I8080_TRACE_H
+#define I8080_TRACE_H
+
+#include "i8080/i8080.h"
+
+#define I8080_TRACE_MAGIC "I8TR"
+#define I8080_TRACE_VERSION 1
+#define I8080_TRACE_HEADER_SIZE 16  // magic, version, record size, count
+#define I8080_TRACE_RECORD_SIZE 20  // serialized i8080_trace_record_t
+
+// cpu state before the instruction at pc executed
+typedef struct {
+  uint16_t pc, sp;
+  uint32_t cycles;  // low 32 bits, enough to time nearby records
+  uint8_t opcode, operand1, operand2;
+  uint8_t flags;  // PSW format
+  uint8_t a, b, c, d, e, h, l;
+  uint8_t ie;
+} i8080_trace_record_t;
+
+// single producer: only the thread stepping the cpu writes records. head is
+// published with release semantics so other threads can snapshot the ring
+typedef struct i8080_trace_t {
+  i8080_trace_record_t* records;
+  uint32_t mask;  // capacity - 1, capacity is a power of two
+  uint64_t head;  // records written since creation
+} i8080_trace_t;
+
+i8080_trace_t* create_i8080_trace(uint32_t capacity);
+void destroy_i8080_trace(i8080_trace_t* trace);
+
+void i8080_trace_record(i8080_trace_t* trace, const i8080_t* state);
+
+// copies up to max most recent records, oldest first, returns count
+uint32_t i8080_trace_snapshot(const i8080_trace_t* trace,
+                              i8080_trace_record_t* records,
+                              uint32_t max);
+
+// binary export, trace file holds header followed by serialized records
+void i8080_trace_save(const i8080_trace_t* trace, const char* file_name);
+void i8080_trace_write_fd(const i8080_trace_t* trace, int fd);
+
+// writes trace to file_name on SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT.
+// up to 8 traces can be registered, not thread safe
+void i8080_trace_dump_on_crash(const i8080_trace_t* trace,
+                               const char* file_name);
+
+// reading, for offline tools
+FILE* i8080_trace_open(const char* file_name, uint32_t* count);
+bool i8080_trace_read(FILE* file, i8080_trace_record_t* record);
+
+#endif  // I8080_TRACE_H
@@ -1,84 +1,176 @@
+// runs the cpu test roms in parallel, one thread and cpu per rom
+#define _POSIX_C_SOURCE 200809L
+
 #include "i8080/i8080.h"
+#include "i8080/testrom.h"
+#include "i8080/trace.h"
 
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-void file_to_mem(uint8_t* memory, const char* file_name, uint16_t offset) {
-  // try open file
-  FILE* file = fopen(file_name, "rb");
-  if (!file) {
-    printf("Could not read file: %s\n", file_name);
-    exit(0);
-  }
+#define RUN_TESTS_DEFAULT_TIMEOUT 300  // seconds, 8080EXM takes ~90 at -O0
+#define RUN_TESTS_POLL_MS 10
 
-  // get file size
-  fseek(file, 0L, SEEK_END);
-  int file_size = ftell(file);
-  fseek(file, 0L, SEEK_SET);
+enum { TEST_PASS, TEST_FAIL, TEST_TIMEOUT };
 
-  // read file contents into state memory
-  uint8_t* buffer = &memory[offset];
-  fread(buffer, file_size, 1, file);
+typedef struct {
+  const testrom_t* rom;
+  i8080_t state;
+  testrom_result_t result;
+  char trace_file[256];
+
+  pthread_t thread;
+  int done;    // set by the test thread when finished
+  int cancel;  // set by the main thread on timeout
+  double seconds;
+} test_t;
+
+static double now_seconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
 
-  memory[368] = 0x7;
-  fclose(file);
+static void* run_test(void* argument) {
+  test_t* test = argument;
+
+  const double start = now_seconds();
+  testrom_run(&test->state, &test->result, UINT64_MAX, &test->cancel);
+  test->seconds = now_seconds() - start;
+
+  __atomic_store_n(&test->done, 1, __ATOMIC_RELEASE);
+  return NULL;
 }
 
-void run_testrom(i8080_t* state) {
-  state->pc = 0x100;  // tests starting point
+static bool all_done(const test_t* tests, int count) {
+  for (int i = 0; i < count; i++) {
+    if (!__atomic_load_n(&tests[i].done, __ATOMIC_ACQUIRE))
+      return false;
+  }
 
-  i8080_write_byte(state, 5, 0xc9);
+  return true;
+}
 
+static int report_test(const test_t* test) {
   printf("*******************\n");
+  printf("%s", test->result.output);
+
+  int status;
+  if (test->result.cancelled) {
+    printf("\nTimed out after %" PRIu64 " instructions at 0x%04X\n",
+           test->result.instructions, test->state.pc);
+    status = TEST_TIMEOUT;
+  } else {
+    if (test->result.halted)
+      printf("\nHLT at %04X\n", test->state.pc);
+    status = testrom_passed(test->rom, &test->result) ? TEST_PASS : TEST_FAIL;
+  }
 
-  while (1) {
-    const uint16_t current_pc = state->pc;
+  printf("\n%s %s (%.3f s)\n\n", test->rom->file_name,
+         status == TEST_PASS ? "PASS" : status == TEST_FAIL ? "FAIL" : "TIMEOUT",
+         test->seconds);
+  return status;
+}
 
-    if (i8080_read_byte(state, state->pc) == 0x76)
-      printf("HLT at %04X\n", state->pc);
+static bool selected(const testrom_t* rom, char** filters, int filter_count) {
+  if (filter_count == 0)
+    return true;
 
-    if (state->pc == 5) {
-      if (state->c == 9) {
-        for (uint16_t i = (state->d << 8 | state->e);
-             i8080_read_byte(state, i) != '$'; i++)
-          printf("%c", i8080_read_byte(state, i));
-      }
+  for (int i = 0; i < filter_count; i++) {
+    if (strstr(rom->file_name, filters[i]))
+      return true;
+  }
 
-      if (state->c == 2)
-        printf("%c", state->e);
-    }
+  return false;
+}
 
-    // i8080_disassemble(state->external_memory, state->pc);
-    i8080_step(state);
-    // i8080_print(state);
+static void print_usage(const char* program) {
+  printf("usage: %s [--timeout <seconds>] [--trace <file>] [rom...]\n",
+         program);
+  printf("  rom filters the suite by file name, e.g. TST8080\n");
+}
 
-    if (state->pc == 0) {
-      printf("\nJumped to 0x0000 from 0x%04X\n\n", current_pc);
-      break;
+int main(int argc, char* argv[]) {
+  double timeout = RUN_TESTS_DEFAULT_TIMEOUT;
+  const char* trace_file = NULL;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+      timeout = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_file = argv[++i];
+    } else {
+      print_usage(argv[0]);
+      return 1;
     }
   }
-}
 
-int main() {
-  i8080_t state;
-  init_i8080(&state);
-  state.external_memory = malloc(I8080_MAX_MEMORY);
-  int mem_length = sizeof(state.external_memory);
+  test_t* tests = calloc(TESTROM_SUITE_SIZE, sizeof(test_t));
+  int count = 0;
+
+  // roms are loaded and traces registered before any thread starts
+  for (size_t rom = 0; rom < TESTROM_SUITE_SIZE; rom++) {
+    if (!selected(&TESTROM_SUITE[rom], &argv[i], argc - i))
+      continue;
+
+    test_t* test = &tests[count++];
+    test->rom = &TESTROM_SUITE[rom];
+    init_i8080(&test->state);
+    test->state.external_memory = malloc(I8080_MAX_MEMORY);
+
+    // last instructions of each rom are written to <file>.<n> on exit or crash
+    if (trace_file) {
+      snprintf(test->trace_file, sizeof(test->trace_file), "%s.%d", trace_file,
+               count - 1);
+      test->state.trace = create_i8080_trace(1 << 16);
+      i8080_trace_dump_on_crash(test->state.trace, test->trace_file);
+    }
 
-  memset(state.external_memory, 0, mem_length);
-  file_to_mem(state.external_memory, "tests/TST8080.COM", 0x100);
-  run_testrom(&state);
+    testrom_load(&test->state, test->rom->file_name);
+  }
+
+  if (count == 0) {
+    print_usage(argv[0]);
+    return 1;
+  }
 
-  memset(state.external_memory, 0, mem_length);
-  file_to_mem(state.external_memory, "tests/CPUTEST.COM", 0x100);
-  run_testrom(&state);
+  const double start = now_seconds();
+  for (int test = 0; test < count; test++)
+    pthread_create(&tests[test].thread, NULL, run_test, &tests[test]);
+
+  const struct timespec poll = {0, RUN_TESTS_POLL_MS * 1000000L};
+  while (!all_done(tests, count) && now_seconds() - start < timeout)
+    nanosleep(&poll, NULL);
+
+  for (int test = 0; test < count; test++) {
+    __atomic_store_n(&tests[test].cancel, 1, __ATOMIC_RELAXED);
+    pthread_join(tests[test].thread, NULL);
+  }
+
+  // results in suite order, independent of completion order
+  int status = TEST_PASS;
+  int passed = 0;
+  for (int test = 0; test < count; test++) {
+    const int test_status = report_test(&tests[test]);
+    passed += test_status == TEST_PASS;
+    if (test_status > status)
+      status = test_status;
+
+    if (tests[test].state.trace) {
+      i8080_trace_save(tests[test].state.trace, tests[test].trace_file);
+      destroy_i8080_trace(tests[test].state.trace);
+    }
+    free(tests[test].state.external_memory);
+  }
 
-  memset(state.external_memory, 0, mem_length);
-  file_to_mem(state.external_memory, "tests/8080PRE.COM", 0x100);
-  run_testrom(&state);
+  printf("%d of %d roms passed in %.3f s\n", passed, count,
+         now_seconds() - start);
 
-  memset(state.external_memory, 0, mem_length);
-  file_to_mem(state.external_memory, "tests/8080EXM.COM", 0x100);
-  run_testrom(&state);
+  free(tests);
+  return status;
 }
@@ -0,0 +1,223 @@
+#include "i8080/profile.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+// sort key for report, qsort has no context argument
+static const uint64_t* sort_values;
+
+static int compare_descending(const void* a, const void* b) {
+  const uint64_t va = sort_values[*(const uint32_t*)a];
+  const uint64_t vb = sort_values[*(const uint32_t*)b];
+
+  return (va < vb) - (va > vb);
+}
+
+static uint32_t sorted_indices(const uint64_t* values,
+                               uint32_t count,
+                               uint32_t* indices) {
+  uint32_t used = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (values[i])
+      indices[used++] = i;
+  }
+
+  sort_values = values;
+  qsort(indices, used, sizeof(uint32_t), compare_descending);
+
+  return used;
+}
+
+static double percent(uint64_t part, uint64_t total) {
+  return total ? 100.0 * part / total : 0.0;
+}
+
+static uint16_t current_function(const i8080_profile_t* profile) {
+  return profile->depth ? profile->stack[profile->depth - 1].function : 0;
+}
+
+static i8080_profile_edge_t* find_edge(i8080_profile_t* profile,
+                                       uint16_t caller,
+                                       uint16_t callee) {
+  const uint32_t key = caller << 16 | callee;
+  uint32_t slot = (key * 2654435761u) & (I8080_PROFILE_EDGES - 1);
+
+  for (uint32_t probe = 0; probe < I8080_PROFILE_EDGES; probe++) {
+    i8080_profile_edge_t* edge = &profile->edges[slot];
+
+    if (!edge->used) {
+      edge->used = true;
+      edge->caller = caller;
+      edge->callee = callee;
+      return edge;
+    }
+
+    if (edge->caller == caller && edge->callee == callee)
+      return edge;
+
+    slot = (slot + 1) & (I8080_PROFILE_EDGES - 1);
+  }
+
+  return NULL;  // table full, edge is not recorded
+}
+
+static void enter_function(i8080_profile_t* profile,
+                           uint16_t function,
+                           uint16_t return_address,
+                           uint64_t entry_cycles) {
+  i8080_profile_edge_t* edge =
+      find_edge(profile, current_function(profile), function);
+  if (edge)
+    edge->calls++;
+
+  profile->function_calls[function]++;
+
+  if (profile->depth < I8080_PROFILE_STACK) {
+    i8080_profile_frame_t* frame = &profile->stack[profile->depth++];
+    frame->function = function;
+    frame->return_address = return_address;
+    frame->entry_cycles = entry_cycles;
+  }
+}
+
+// unwinds to the frame returning to pc, returns without matching frame are
+// ignored
+static void leave_function(i8080_profile_t* profile, uint16_t pc) {
+  uint32_t depth = profile->depth;
+  while (depth > 0 && profile->stack[depth - 1].return_address != pc)
+    depth--;
+
+  if (depth == 0)
+    return;
+
+  while (profile->depth >= depth) {
+    const i8080_profile_frame_t* frame = &profile->stack[--profile->depth];
+    const uint64_t cycles = profile->total_cycles - frame->entry_cycles;
+
+    profile->function_total_cycles[frame->function] += cycles;
+
+    i8080_profile_edge_t* edge =
+        find_edge(profile, current_function(profile), frame->function);
+    if (edge)
+      edge->cycles += cycles;
+  }
+}
+
+i8080_profile_t* create_i8080_profile() {
+  i8080_profile_t* profile = calloc(1, sizeof(i8080_profile_t));
+
+  return profile;
+}
+
+void destroy_i8080_profile(i8080_profile_t* profile) {
+  free(profile);
+}
+
+void i8080_profile_count(i8080_profile_t* profile,
+                         const i8080_t* state,
+                         uint16_t pc,
+                         uint16_t sp,
+                         uint8_t opcode,
+                         uint32_t cycles) {
+  // control transferred outside i8080_step while pushing a return address is
+  // an interrupt
+  if (profile->total_instructions && pc != profile->next_pc &&
+      sp == (uint16_t)(profile->next_sp - 2)) {
+    const uint16_t pushed = (state->external_memory[(uint16_t)(sp + 1)] << 8) |
+                            state->external_memory[sp];
+    enter_function(profile, pc, pushed, profile->total_cycles);
+  }
+
+  const uint64_t entry_cycles = profile->total_cycles;
+
+  profile->total_cycles += cycles;
+  profile->total_instructions++;
+  profile->pc_cycles[pc] += cycles;
+  profile->pc_count[pc]++;
+  profile->opcode_cycles[opcode] += cycles;
+  profile->opcode_count[opcode]++;
+  profile->function_self_cycles[current_function(profile)] += cycles;
+
+  switch (opcode) {
+    case 0xc4: case 0xcc: case 0xcd: case 0xd4:  // CALL, conditional calls
+    case 0xdc: case 0xdd: case 0xe4: case 0xec:
+    case 0xed: case 0xf4: case 0xfc: case 0xfd:
+      if (state->sp == (uint16_t)(sp - 2))
+        enter_function(profile, state->pc, pc + 3, entry_cycles);
+      break;
+
+    case 0xc7: case 0xcf: case 0xd7: case 0xdf:  // RST
+    case 0xe7: case 0xef: case 0xf7: case 0xff:
+      enter_function(profile, state->pc, pc + 1, entry_cycles);
+      break;
+
+    case 0xc0: case 0xc8: case 0xc9: case 0xd0:  // RET, conditional returns
+    case 0xd8: case 0xd9: case 0xe0: case 0xe8:
+    case 0xf0: case 0xf8:
+      if (state->sp == (uint16_t)(sp + 2))
+        leave_function(profile, state->pc);
+      break;
+  }
+
+  profile->next_pc = state->pc;
+  profile->next_sp = state->sp;
+}
+
+void i8080_profile_report(const i8080_profile_t* profile,
+                          const unsigned char* memory) {
+  uint32_t* indices = malloc(I8080_MAX_MEMORY * sizeof(uint32_t));
+  const uint64_t total = profile->total_cycles;
+
+  printf("*** profile: %" PRIu64 " cycles, %" PRIu64 " instructions\n\n",
+         total, profile->total_instructions);
+
+  printf("hot spots\n");
+  printf("cycles       %%      count        address instruction\n");
+  uint32_t used = sorted_indices(profile->pc_cycles, I8080_MAX_MEMORY, indices);
+  for (uint32_t i = 0; i < used && i < I8080_PROFILE_REPORT_LINES; i++) {
+    const uint32_t pc = indices[i];
+    char text[I8080_DISASSEMBLY_LENGTH];
+    i8080_disassemble_to(memory, pc, text, sizeof(text));
+
+    printf("%-12" PRIu64 " %5.2f  %-12" PRIu64 " %04x %s\n",
+           profile->pc_cycles[pc], percent(profile->pc_cycles[pc], total),
+           profile->pc_count[pc], pc, text);
+  }
+
+  printf("\nopcodes\n");
+  printf("cycles       %%      count        opcode\n");
+  used = sorted_indices(profile->opcode_cycles, 256, indices);
+  for (uint32_t i = 0; i < used && i < I8080_PROFILE_REPORT_LINES; i++) {
+    const uint32_t opcode = indices[i];
+    printf("%-12" PRIu64 " %5.2f  %-12" PRIu64 " %02x %s\t%s\n",
+           profile->opcode_cycles[opcode],
+           percent(profile->opcode_cycles[opcode], total),
+           profile->opcode_count[opcode], opcode,
+           I8080_OPCODES[opcode].mnemonic, I8080_OPCODES[opcode].operands);
+  }
+
+  printf("\ncall graph, subroutines by inclusive cycles\n");
+  printf("inclusive    %%      self         %%      calls        address\n");
+  used = sorted_indices(profile->function_total_cycles, I8080_MAX_MEMORY,
+                        indices);
+  for (uint32_t i = 0; i < used && i < I8080_PROFILE_REPORT_LINES; i++) {
+    const uint32_t function = indices[i];
+    printf("%-12" PRIu64 " %5.2f  %-12" PRIu64 " %5.2f  %-12" PRIu64
+           " %04x\n",
+           profile->function_total_cycles[function],
+           percent(profile->function_total_cycles[function], total),
+           profile->function_self_cycles[function],
+           percent(profile->function_self_cycles[function], total),
+           profile->function_calls[function], function);
+
+    for (uint32_t e = 0; e < I8080_PROFILE_EDGES; e++) {
+      const i8080_profile_edge_t* edge = &profile->edges[e];
+      if (edge->used && edge->caller == function)
+        printf("    -> %04x  %" PRIu64 " calls, %" PRIu64 " cycles\n",
+               edge->callee, edge->calls, edge->cycles);
+    }
+  }
+
+  free(indices);
+}
@@ -0,0 +1,96 @@
+#include "i8080/testrom.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const testrom_t TESTROM_SUITE[] = {
+    {"tests/TST8080.COM", "CPU IS OPERATIONAL"},
+    {"tests/CPUTEST.COM", "CPU TESTS OK"},
+    {"tests/8080PRE.COM", "Preliminary tests complete"},
+    {"tests/8080EXM.COM", "Tests complete"},
+};
+
+const size_t TESTROM_SUITE_SIZE = sizeof(TESTROM_SUITE) / sizeof(TESTROM_SUITE[0]);
+
+static void append_output(testrom_result_t* result, char c) {
+  if (c != '\0' && result->output_length + 1 < TESTROM_OUTPUT_SIZE) {
+    result->output[result->output_length++] = c;
+    result->output[result->output_length] = '\0';
+  }
+}
+
+// C=9 prints string at DE terminated by '$', C=2 prints character in E
+static void bdos_call(i8080_t* state, testrom_result_t* result) {
+  if (state->c == 9) {
+    for (uint16_t i = (state->d << 8 | state->e);
+         i8080_read_byte(state, i) != '$'; i++)
+      append_output(result, i8080_read_byte(state, i));
+  }
+
+  if (state->c == 2)
+    append_output(result, state->e);
+}
+
+void testrom_load(i8080_t* state, const char* file_name) {
+  uint8_t* memory = state->external_memory;
+
+  FILE* file = fopen(file_name, "rb");
+  if (!file) {
+    printf("Could not read file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  struct i8080_trace_t* trace = state->trace;
+  struct i8080_profile_t* profile = state->profile;
+
+  init_i8080(state);
+  state->external_memory = memory;
+  state->trace = trace;
+  state->profile = profile;
+  memset(memory, 0, I8080_MAX_MEMORY);
+
+  fread(&memory[TESTROM_LOAD_ADDRESS], 1,
+        I8080_MAX_MEMORY - TESTROM_LOAD_ADDRESS, file);
+  fclose(file);
+
+  i8080_write_byte(state, TESTROM_BDOS_ADDRESS, 0xc9);  // RET
+  state->pc = TESTROM_LOAD_ADDRESS;
+}
+
+void testrom_run(i8080_t* state,
+                 testrom_result_t* result,
+                 uint64_t max_instructions,
+                 const int* cancel) {
+  memset(result, 0, sizeof(testrom_result_t));
+
+  while (result->instructions < max_instructions) {
+    if (cancel && result->instructions % TESTROM_CANCEL_INTERVAL == 0 &&
+        __atomic_load_n(cancel, __ATOMIC_RELAXED)) {
+      result->cancelled = true;
+      break;
+    }
+
+    if (state->pc == TESTROM_BDOS_ADDRESS)
+      bdos_call(state, result);
+
+    if (i8080_read_byte(state, state->pc) == 0x76) {
+      result->halted = true;
+      break;
+    }
+
+    const uint64_t start_cycles = state->cycles;
+    i8080_step(state);
+    result->cycles += state->cycles - start_cycles;
+    result->instructions++;
+
+    if (state->pc == 0) {
+      result->finished = true;
+      break;
+    }
+  }
+}
+
+bool testrom_passed(const testrom_t* rom, const testrom_result_t* result) {
+  return result->finished && strstr(result->output, rom->pass) &&
+         !strstr(result->output, "ERROR");
+}
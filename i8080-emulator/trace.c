@@ -0,0 +1,297 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "i8080/trace.h"
+#include "i8080/ring.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRACE_WRITE_CHUNK 64  // records serialized per write call
+#define TRACE_CRASH_SLOTS 8   // traces written by the crash handler
+
+typedef struct {
+  const i8080_trace_t* trace;
+  char file_name[256];
+} crash_slot_t;
+
+static crash_slot_t crash_slots[TRACE_CRASH_SLOTS];
+
+static uint8_t psw_flags(const conditionbits_t* cb) {
+  return cb->flags.s << 7 | cb->flags.z << 6 | cb->flags.ac << 4 |
+         cb->flags.p << 2 | 1 << 1 | cb->flags.c;
+}
+
+static void write_u16(uint8_t* buffer, uint16_t value) {
+  buffer[0] = value & 0xff;
+  buffer[1] = value >> 8;
+}
+
+static void write_u32(uint8_t* buffer, uint32_t value) {
+  write_u16(buffer, value & 0xffff);
+  write_u16(buffer + 2, value >> 16);
+}
+
+static uint16_t read_u16(const uint8_t* buffer) {
+  return buffer[0] | (buffer[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t* buffer) {
+  return read_u16(buffer) | ((uint32_t)read_u16(buffer + 2) << 16);
+}
+
+static void serialize_record(const i8080_trace_record_t* record,
+                             uint8_t* buffer) {
+  write_u16(&buffer[0], record->pc);
+  write_u16(&buffer[2], record->sp);
+  write_u32(&buffer[4], record->cycles);
+  buffer[8] = record->opcode;
+  buffer[9] = record->operand1;
+  buffer[10] = record->operand2;
+  buffer[11] = record->flags;
+  buffer[12] = record->a;
+  buffer[13] = record->b;
+  buffer[14] = record->c;
+  buffer[15] = record->d;
+  buffer[16] = record->e;
+  buffer[17] = record->h;
+  buffer[18] = record->l;
+  buffer[19] = record->ie;
+}
+
+static void deserialize_record(const uint8_t* buffer,
+                               i8080_trace_record_t* record) {
+  record->pc = read_u16(&buffer[0]);
+  record->sp = read_u16(&buffer[2]);
+  record->cycles = read_u32(&buffer[4]);
+  record->opcode = buffer[8];
+  record->operand1 = buffer[9];
+  record->operand2 = buffer[10];
+  record->flags = buffer[11];
+  record->a = buffer[12];
+  record->b = buffer[13];
+  record->c = buffer[14];
+  record->d = buffer[15];
+  record->e = buffer[16];
+  record->h = buffer[17];
+  record->l = buffer[18];
+  record->ie = buffer[19];
+}
+
+static void serialize_header(uint32_t count, uint8_t* buffer) {
+  memcpy(buffer, I8080_TRACE_MAGIC, 4);
+  write_u32(&buffer[4], I8080_TRACE_VERSION);
+  write_u32(&buffer[8], I8080_TRACE_RECORD_SIZE);
+  write_u32(&buffer[12], count);
+}
+
+static uint32_t stored_records(uint64_t head, uint32_t capacity) {
+  return head < capacity ? (uint32_t)head : capacity;
+}
+
+i8080_trace_t* create_i8080_trace(uint32_t capacity) {
+  uint32_t size = 1;
+  while (size < capacity)
+    size <<= 1;
+
+  i8080_trace_t* trace = calloc(1, sizeof(i8080_trace_t));
+  trace->records = calloc(size, sizeof(i8080_trace_record_t));
+  trace->mask = size - 1;
+  trace->head = 0;
+
+  return trace;
+}
+
+void destroy_i8080_trace(i8080_trace_t* trace) {
+  for (int i = 0; i < TRACE_CRASH_SLOTS; i++) {
+    if (crash_slots[i].trace == trace)
+      crash_slots[i].trace = NULL;
+  }
+
+  free(trace->records);
+  free(trace);
+}
+
+void i8080_trace_record(i8080_trace_t* trace, const i8080_t* state) {
+  const uint64_t head = trace->head;
+  i8080_trace_record_t* record = &trace->records[head & trace->mask];
+  const uint8_t* memory = state->external_memory;
+
+  // operands wrap around at the end of memory like the pc
+  record->pc = state->pc;
+  record->sp = state->sp;
+  record->cycles = state->cycles;
+  record->opcode = memory[state->pc];
+  record->operand1 = memory[(state->pc + 1) & 0xffff];
+  record->operand2 = memory[(state->pc + 2) & 0xffff];
+  record->flags = psw_flags(&state->cb);
+  record->a = state->a;
+  record->b = state->b;
+  record->c = state->c;
+  record->d = state->d;
+  record->e = state->e;
+  record->h = state->h;
+  record->l = state->l;
+  record->ie = state->ie;
+
+  __atomic_store_n(&trace->head, head + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t i8080_trace_snapshot(const i8080_trace_t* trace,
+                              i8080_trace_record_t* records,
+                              uint32_t max) {
+  const uint32_t capacity = trace->mask + 1;
+  const uint64_t head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+
+  uint32_t count = stored_records(head, capacity);
+  if (count > max)
+    count = max;
+
+  const uint64_t start = head - count;
+  for (uint32_t i = 0; i < count; i++)
+    records[i] = trace->records[(start + i) & trace->mask];
+
+  // records overwritten by the producer while copying are dropped
+  const uint64_t head_after = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+  const uint64_t valid_start = ring_first_valid(head_after, capacity);
+
+  if (valid_start > start) {
+    const uint64_t dropped = valid_start - start;
+    if (dropped >= count)
+      return 0;
+
+    memmove(records, &records[dropped],
+            (count - dropped) * sizeof(i8080_trace_record_t));
+    count -= dropped;
+  }
+
+  return count;
+}
+
+// async-signal-safe, no allocation or stdio
+void i8080_trace_write_fd(const i8080_trace_t* trace, int fd) {
+  const uint64_t head = trace->head;
+  const uint32_t count = stored_records(head, trace->mask + 1);
+
+  uint8_t header[I8080_TRACE_HEADER_SIZE];
+  serialize_header(count, header);
+  if (write(fd, header, sizeof(header)) < 0)
+    return;
+
+  uint8_t chunk[TRACE_WRITE_CHUNK * I8080_TRACE_RECORD_SIZE];
+  const uint64_t start = head - count;
+
+  for (uint32_t i = 0; i < count; i += TRACE_WRITE_CHUNK) {
+    uint32_t records = count - i;
+    if (records > TRACE_WRITE_CHUNK)
+      records = TRACE_WRITE_CHUNK;
+
+    for (uint32_t j = 0; j < records; j++)
+      serialize_record(&trace->records[(start + i + j) & trace->mask],
+                       &chunk[j * I8080_TRACE_RECORD_SIZE]);
+
+    if (write(fd, chunk, records * I8080_TRACE_RECORD_SIZE) < 0)
+      return;
+  }
+}
+
+void i8080_trace_save(const i8080_trace_t* trace, const char* file_name) {
+  const uint32_t capacity = trace->mask + 1;
+  i8080_trace_record_t* records =
+      malloc(capacity * sizeof(i8080_trace_record_t));
+  const uint32_t count = i8080_trace_snapshot(trace, records, capacity);
+
+  FILE* file = fopen(file_name, "wb");
+  if (!file) {
+    printf("Could not write file: %s\n", file_name);
+    free(records);
+    return;
+  }
+
+  uint8_t header[I8080_TRACE_HEADER_SIZE];
+  serialize_header(count, header);
+  fwrite(header, sizeof(header), 1, file);
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t buffer[I8080_TRACE_RECORD_SIZE];
+    serialize_record(&records[i], buffer);
+    fwrite(buffer, sizeof(buffer), 1, file);
+  }
+
+  fclose(file);
+  free(records);
+}
+
+static void crash_handler(int signal_number) {
+  for (int i = 0; i < TRACE_CRASH_SLOTS; i++) {
+    if (!crash_slots[i].trace)
+      continue;
+
+    const int fd =
+        open(crash_slots[i].file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      i8080_trace_write_fd(crash_slots[i].trace, fd);
+      close(fd);
+    }
+  }
+
+  // let default action terminate the process
+  signal(signal_number, SIG_DFL);
+  raise(signal_number);
+}
+
+void i8080_trace_dump_on_crash(const i8080_trace_t* trace,
+                               const char* file_name) {
+  int slot = 0;
+  while (slot < TRACE_CRASH_SLOTS && crash_slots[slot].trace)
+    slot++;
+
+  if (slot == TRACE_CRASH_SLOTS) {
+    printf("Too many traces registered for crash dump: %s\n", file_name);
+    return;
+  }
+
+  crash_slots[slot].trace = trace;
+  strncpy(crash_slots[slot].file_name, file_name,
+          sizeof(crash_slots[slot].file_name) - 1);
+
+  const int signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+  for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = crash_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(signals[i], &action, NULL);
+  }
+}
+
+FILE* i8080_trace_open(const char* file_name, uint32_t* count) {
+  FILE* file = fopen(file_name, "rb");
+  if (!file) {
+    printf("Could not read file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  uint8_t header[I8080_TRACE_HEADER_SIZE];
+  if (fread(header, sizeof(header), 1, file) != 1 ||
+      memcmp(header, I8080_TRACE_MAGIC, 4) != 0 ||
+      read_u32(&header[4]) != I8080_TRACE_VERSION ||
+      read_u32(&header[8]) != I8080_TRACE_RECORD_SIZE) {
+    printf("Not a trace file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  *count = read_u32(&header[12]);
+  return file;
+}
+
+bool i8080_trace_read(FILE* file, i8080_trace_record_t* record) {
+  uint8_t buffer[I8080_TRACE_RECORD_SIZE];
+  if (fread(buffer, sizeof(buffer), 1, file) != 1)
+    return false;
+
+  deserialize_record(buffer, record);
+  return true;
+}
@@ -0,0 +1,45 @@
+// prints a binary instruction trace with disassembly
+#include "i8080/trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char* argv[]) {
+  if (argc != 2 && !(argc == 4 && strcmp(argv[2], "--last") == 0)) {
+    printf("usage: %s <trace> [--last <n>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  uint32_t count;
+  FILE* file = i8080_trace_open(argv[1], &count);
+
+  uint32_t skip = 0;
+  if (argc == 4) {
+    const uint32_t last = strtoul(argv[3], NULL, 10);
+    skip = last < count ? count - last : 0;
+  }
+
+  printf("cycles      a  bc   de   hl   sp   szapc  pc   instruction\n");
+
+  i8080_trace_record_t record;
+  for (uint32_t i = 0; i8080_trace_read(file, &record); i++) {
+    if (i < skip)
+      continue;
+
+    const uint8_t bytes[] = {record.opcode, record.operand1, record.operand2};
+    i8080_instruction_t instruction;
+    char text[I8080_DISASSEMBLY_LENGTH];
+    i8080_decode(bytes, record.pc, &instruction);
+    i8080_format_instruction(&instruction, text, sizeof(text));
+
+    printf("%-10u  %02x %02x%02x %02x%02x %02x%02x %04x %c%c%c%c%c  %04x %s\n",
+           record.cycles, record.a, record.b, record.c, record.d, record.e,
+           record.h, record.l, record.sp, record.flags & 0x80 ? 's' : '-',
+           record.flags & 0x40 ? 'z' : '-', record.flags & 0x10 ? 'a' : '-',
+           record.flags & 0x04 ? 'p' : '-', record.flags & 0x01 ? 'c' : '-',
+           record.pc, text);
+  }
+
+  fclose(file);
+  return 0;
+}
@@ -11,29 +11,139 @@
 #define MACHINE_FPS 60
 #define MACHINE_CLOCK_RATE 2000000  // 2MHz
 #define MACHINE_CYCLES_PER_FRAME \
-  MACHINE_CLOCK_RATE /           \
-      MACHINE_FPS  // 2x10^6 cpu per second. 60 frames per second
+  (MACHINE_CLOCK_RATE /          \
+   MACHINE_FPS)  // 2x10^6 cpu per second. 60 frames per second
 #define MACHINE_HALF_CYCLES_PER_FRAME \
-  MACHINE_CYCLES_PER_FRAME / 2  // used for interrupts
+  (MACHINE_CYCLES_PER_FRAME / 2)  // used for interrupts
+#define MACHINE_RAM_START 0x2000
+#define MACHINE_RAM_SIZE 0x2000  // work ram and video ram
+#define MACHINE_VRAM_START 0x2400
+#define MACHINE_VRAM_SIZE 0x1c00
+#define MACHINE_PORTS 256
+#define MACHINE_ROM_DIRECTORY "res/roms"
+#define MACHINE_COLOR_PROM_SIZE 0x400
 
+// the monitor is rotated, each raster line is a screen column of 32 bytes
+// drawn from the bottom. RST 1 fires at the middle line and RST 2 at the
+// first blanking line
+#define MACHINE_RASTER_LINES 262
+#define MACHINE_VISIBLE_LINES MACHINE_SCREEN_WIDTH
+#define MACHINE_MID_SCREEN_LINE 96
+#define MACHINE_LINE_BYTES 0x20
+
+// external shift register used by the game to draw sprites at pixel offsets.
+// OUT 4 shifts a byte in from the left, OUT 2 sets the offset, IN 3 reads the
+// byte at offset bits from the left
+typedef struct {
+  uint16_t value;  // last byte written in the upper half
+  uint8_t offset;
+} machine_shifter_t;
+
+struct machine_t;
+struct machine_board_t;
+
+// IN and OUT handlers indexed by port number, NULL for unconnected ports.
+// i8080_step calls them through the cpu's in and out hooks while executing
+// the instruction, an unconnected IN leaves A unchanged
 typedef struct {
+  uint8_t (*in[MACHINE_PORTS])(struct machine_t* machine);
+  void (*out[MACHINE_PORTS])(struct machine_t* machine, uint8_t value);
+} machine_ports_t;
+
+typedef struct machine_t {
   i8080_t cpu;
+  const struct machine_board_t* board;
+
+  // copied from board at creation
+  const machine_ports_t* ports;
+  void (*render)(const struct machine_t* machine,
+                 uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+                 int first_line,
+                 int end_line);
+
   uint8_t* memory;
+  uint8_t* color_prom;  // NULL when board has none or it was not found
   uint8_t screen_buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3];
+  bool scanline;  // raster lines are converted into screen_buffer as the
+                  // beam passes them instead of once per frame
 
+  // absolute cpu cycles, cpu.cycles counts from power-on
+  uint64_t interrupt_deadline;  // next half frame interrupt
+  uint64_t frame_deadline;      // end of the current frame
   uint8_t next_interrupt;
   uint8_t in_port1, in_port2;
-  uint8_t shift0, shift1, shift_offset;
+  machine_shifter_t shifter;
+
+  struct sound_t* sound;  // receives writes to sound ports 3 and 5 when set
+  FILE* hash_log;  // receives state hash every frame when set
+  struct latency_t* latency;  // notified of input port reads when set
+  struct debug_server_t* debug_server;  // serves a remote debugger when set
+  struct metrics_thread_t* metrics;  // counters of the emulation thread
 } machine_t;
 
-machine_t* create_machine();
+// ram and register state, enough to rewind a running game. rom and the
+// screen buffer are not included
+typedef struct {
+  i8080_t cpu;
+  uint8_t ram[MACHINE_RAM_SIZE];
+
+  uint64_t interrupt_deadline, frame_deadline;
+  uint8_t next_interrupt;
+  uint8_t in_port1, in_port2;
+  machine_shifter_t shifter;
+} machine_snapshot_t;
+
+machine_t* create_machine(const struct machine_board_t* board);
 void destroy_machine(machine_t* machine);
 
-void machine_update_state(machine_t* machine);
+int machine_step(machine_t* machine);
+
+// raises the pending RST once the cpu passed the interrupt deadline, part of
+// machine_step for callers stepping the cpu themselves
+void machine_check_interrupt(machine_t* machine);
+bool machine_update_state(machine_t* machine);
 
 void machine_update_screen_buffer(machine_t* machine);
 
-void machine_load_invaders(machine_t* machine);
+// converts video ram into an RGB frame with the board's video decoder, buffer
+// may be owned by another thread. in scanline mode screen_buffer is copied
+void machine_render_to(
+    const machine_t* machine,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3]);
+
+// monochrome conversion from a copy of video ram, MACHINE_VRAM_SIZE bytes
+void machine_render_vram(
+    const uint8_t* vram,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3]);
+
+// row kernel shared by all video decoders, expands the MACHINE_LINE_BYTES
+// bytes of raster line into column line of buffer. byte i takes the RGB
+// triple at colors[3 * i], white when colors is NULL
+void machine_render_line(
+    const uint8_t* vram_line,
+    const uint8_t* colors,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+    int line);
+
+void machine_save_state(const machine_t* machine,
+                        machine_snapshot_t* snapshot);
+void machine_load_state(machine_t* machine, const machine_snapshot_t* snapshot);
+
+// emulates frames ahead with the current port values and renders the last one
+// into buffer, then restores the machine. sound, hash log, latency, trace,
+// profile, debugger, debug server and metrics only see the real frames. vram
+// receives MACHINE_VRAM_SIZE bytes of the rendered frame when not NULL
+void machine_run_ahead(
+    machine_t* machine,
+    int frames,
+    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+    uint8_t* vram);
+
+// hash of ram, cpu registers and port state
+uint64_t machine_state_hash(const machine_t* machine);
+
+// loads rom files of the board from MACHINE_ROM_DIRECTORY
+void machine_load_roms(machine_t* machine);
 
 void machine_file_to_mem(machine_t* machine,
                          const char* file_name,
@@ -0,0 +1,81 @@
+// frame archive of 1bpp video ram with random access. each record holds an
+// image and the number of consecutive frames showing it. images are stored
+// as run length encoded xor against the previous one, with a keyframe holding
+// the full video ram every keyframe_interval frames. records never span a
+// keyframe, so frame / keyframe_interval selects the index entry. version 1
+// wrote one record per frame and is not read anymore
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arcade_machine/arcade_machine.h"
+
+#define ARCHIVE_MAGIC "SIAR"
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_HEADER_SIZE 32  // see archive_create
+// record header: type (1 byte), frames, payload size (2 bytes each)
+#define ARCHIVE_RECORD_SIZE 5
+#define ARCHIVE_MAX_FRAMES 0xffff  // frames of one record
+#define ARCHIVE_KEYFRAME_INTERVAL 300
+#define ARCHIVE_MAX_PAYLOAD (MACHINE_VRAM_SIZE + MACHINE_VRAM_SIZE / 128 + 1)
+
+enum {
+  ARCHIVE_KEYFRAME,  // payload is encoded video ram
+  ARCHIVE_DELTA,     // payload is encoded xor with previous, empty if equal
+};
+
+typedef struct {
+  FILE* file;
+  uint32_t keyframe_interval;
+  uint32_t frame_count;
+
+  uint64_t* index;  // file offset of every keyframe
+  uint32_t index_count, index_capacity;
+
+  uint8_t previous[MACHINE_VRAM_SIZE];
+} archive_writer_t;
+
+// read only, file is memory mapped
+typedef struct {
+  const uint8_t* data;
+  size_t size;
+
+  uint32_t keyframe_interval;
+  uint32_t frame_count;
+  const uint8_t* index;  // index_count little endian offsets
+  uint32_t index_count;
+
+  // last decoded record shows frames cursor_first up to cursor_end,
+  // sequential reads continue from here. cursor_end is 0 when invalid
+  uint32_t cursor_first, cursor_end;
+  uint64_t cursor_offset;  // offset of record after cursor
+  uint8_t vram[MACHINE_VRAM_SIZE];
+} archive_t;
+
+archive_writer_t* archive_create(const char* file_name,
+                                 uint32_t keyframe_interval);
+// vram is shown for frames consecutive frames
+void archive_append(archive_writer_t* writer,
+                    const uint8_t* vram,
+                    uint32_t frames);
+
+// writes index and frame count, then frees writer
+void archive_finish(archive_writer_t* writer);
+
+archive_t* archive_open(const char* file_name);
+void archive_close(archive_t* archive);
+
+// decodes frame into archive->vram, returns false for invalid frame or data
+bool archive_seek(archive_t* archive, uint32_t frame);
+
+// expands a frame through machine_render_vram
+bool archive_render(archive_t* archive,
+                    uint32_t frame,
+                    uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH]
+                                  [3]);
+
+#endif  // ARCHIVE_H
@@ -0,0 +1,52 @@
+// descriptions of the Midway/Taito 8080 boards sharing this hardware: memory
+// map, port handlers, interrupt schedule and video decoder. sound and output
+// port differences between the games are not modelled, see board.c
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "arcade_machine/arcade_machine.h"
+
+#define MACHINE_BOARD_ROMS 8
+#define MACHINE_DEFAULT_BOARD "invaders"
+
+typedef struct {
+  const char* file_name;  // in MACHINE_ROM_DIRECTORY, NULL ends the list
+  uint16_t address;
+} machine_rom_t;
+
+typedef struct machine_board_t {
+  const char* name;
+  const char* title;
+
+  machine_rom_t roms[MACHINE_BOARD_ROMS];
+  const char* color_prom;  // NULL for monochrome boards
+
+  const machine_ports_t* ports;
+  uint8_t interrupts[2];        // RST at middle of screen and at end of screen
+  uint8_t in_port1, in_port2;  // power-on values, dip switches
+
+  // raster lines [first_line, end_line) of video ram to RGB, captures and
+  // archives always store the monochrome image
+  void (*render)(const machine_t* machine,
+                 uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3],
+                 int first_line,
+                 int end_line);
+} machine_board_t;
+
+extern const machine_board_t MACHINE_BOARDS[];
+extern const size_t MACHINE_BOARD_COUNT;
+
+// returns NULL for unknown names
+const machine_board_t* machine_find_board(const char* name);
+
+// board to run a movie on. requested is the --board argument and recorded
+// the board stored in the movie, either may be NULL or empty. without both
+// the default board is used. prints why and returns NULL when the names
+// disagree or are unknown
+const machine_board_t* machine_select_board(const char* requested,
+                                            const char* recorded);
+
+// one line with the names and titles of all boards
+void machine_print_boards(void);
+
+#endif  // BOARD_H
@@ -0,0 +1,58 @@
+// video capture of video ram, written to file by a background thread
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/archive.h"
+
+#define CAPTURE_QUEUE 64  // frames buffered between emulation and writer
+
+typedef enum {
+  CAPTURE_Y4M,      // 8-bit mono, playable by common video tools
+  CAPTURE_ARCHIVE,  // 1bpp video ram frame archive, see archive.h
+} capture_format_t;
+
+typedef struct {
+  uint32_t frame;  // index of the first frame showing this image
+  uint8_t vram[MACHINE_VRAM_SIZE];
+} capture_entry_t;
+
+// consecutive identical frames are only counted, not queued, and repeated by
+// the writer. when the queue is full the emulation thread waits for the writer
+typedef struct {
+  capture_format_t format;
+  FILE* file;                 // y4m
+  archive_writer_t* archive;  // archive
+  pthread_t thread;
+
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  capture_entry_t queue[CAPTURE_QUEUE];
+  uint32_t head, tail;  // guarded by lock
+  bool closing;
+
+  // writer thread, y4m conversion
+  uint8_t rgb[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3];
+  uint8_t luma[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH];
+
+  // emulation thread
+  uint8_t last[MACHINE_VRAM_SIZE];
+  uint32_t frames, unique_frames, stalls;
+} capture_t;
+
+// format is chosen from the extension, .y4m or anything else for an archive
+capture_t* create_capture(const char* file_name);
+
+// queues video ram at MACHINE_VRAM_START of memory for the current frame
+void capture_frame(capture_t* capture, const uint8_t* memory);
+
+// writes remaining frames and closes the file
+void destroy_capture(capture_t* capture);
+
+#endif  // CAPTURE_H
@@ -0,0 +1,72 @@
+// remote debugger on a UNIX domain socket, speaking a subset of the GDB remote
+// serial protocol. a server thread reads packets and queues them, the
+// emulation thread executes them between frames or while the cpu is stopped,
+// so attaching does not pause the game. without a client the cpu runs without
+// debug checks, only the attention flag is read once per frame
+#ifndef DEBUG_SERVER_H
+#define DEBUG_SERVER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "arcade_machine/arcade_machine.h"
+
+#define DEBUG_SERVER_PACKET_SIZE 1024  // payload, also advertised PacketSize
+#define DEBUG_SERVER_INTERRUPT "\x03"  // queued for a ctrl-c from the client
+#define DEBUG_SERVER_DETACH "D"        // queued when the client disconnects
+
+// supported packets, registers are a, flags, b, c, d, e, h, l as bytes and sp,
+// pc as little endian words:
+//   ?            stop reason, OK while running
+//   g, G         read or write registers
+//   m, M         read or write memory, addr,length[:data]
+//   c, s         continue, single step
+//   Z, z         set or clear breakpoint 0/1, write 2, read 3, access 4
+//   QSaveState   snapshot the machine, QLoadState restores it
+//   D, k         detach, the game keeps running
+//   ctrl-c       stop at the next instruction
+typedef struct debug_server_t {
+  int attention;  // set while a command waits, read once per frame
+
+  char path[108];  // sun_path
+  int listen_fd;
+  int client_fd;  // -1 without client, guarded by send_lock
+  pthread_t thread;
+  pthread_mutex_t send_lock;
+
+  // single command slot between server and emulation thread
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  char command[DEBUG_SERVER_PACKET_SIZE + 1];
+  bool pending;
+  bool closing;
+
+  // emulation thread
+  bool halted;       // waiting in debug_server_stopped
+  bool interrupted;  // stop was requested by ctrl-c
+  bool saved;
+  machine_snapshot_t snapshot;
+
+  // put in cpu.debug by the first command of a client unless the machine
+  // already has one, taken out and cleared when the client detaches
+  struct i8080_debug_t* debug;
+} debug_server_t;
+
+// listens on path, replacing a stale socket file. NULL on failure
+debug_server_t* create_debug_server(const char* path);
+
+// disconnects the client and releases a stopped emulation thread, later
+// commands are ignored. called before joining the emulation thread
+void debug_server_shutdown(debug_server_t* server);
+
+// shuts down if needed and removes the socket file
+void destroy_debug_server(debug_server_t* server);
+
+// runs queued commands, called by machine_update_state when attention is set
+void debug_server_service(debug_server_t* server, machine_t* machine);
+
+// reports the stop of machine->cpu.debug and serves commands until the client
+// continues. returns immediately without a client
+void debug_server_stopped(debug_server_t* server, machine_t* machine);
+
+#endif  // DEBUG_SERVER_H
@@ -0,0 +1,37 @@
+// triple buffered frames passed from the emulation thread to the renderer
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "arcade_machine/arcade_machine.h"
+
+#define FRAME_QUEUE_FRESH 0x4  // set in middle when it holds an unread frame
+
+typedef uint8_t machine_frame_t[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH]
+                               [3];
+
+// single producer, single consumer. the producer draws into back and swaps it
+// with middle, the consumer swaps front with middle when a fresh frame is
+// there. neither side ever waits, unread frames are replaced by newer ones
+typedef struct {
+  machine_frame_t buffers[3];
+  int back, front;  // owned by producer and consumer
+  int middle;       // buffer index | FRAME_QUEUE_FRESH, swapped atomically
+
+  uint64_t numbers[3];  // value of published when the buffer was filled
+  uint64_t published;   // written by producer
+  uint64_t presented;  // written by consumer
+} frame_queue_t;
+
+frame_queue_t* create_frame_queue();
+void destroy_frame_queue(frame_queue_t* queue);
+
+// producer
+machine_frame_t* frame_queue_back(frame_queue_t* queue);
+void frame_queue_publish(frame_queue_t* queue);
+
+// consumer, returns latest frame or NULL when nothing new was published
+machine_frame_t* frame_queue_acquire(frame_queue_t* queue);
+
+#endif  // FRAME_QUEUE_H
@@ -0,0 +1,71 @@
+// end-to-end input latency, from key event to the presented frame showing it
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LATENCY_MAX_FRAMES 60  // frames to wait for a visible reaction
+
+// bytes at the start of every video ram line, the bottom 64 pixels of the
+// screen with the cannon, its fresh shot and the credit count
+#define LATENCY_REACTION_BYTES 8
+
+enum {
+  LATENCY_IDLE,
+  LATENCY_PRESSED,    // key event seen by the event loop
+  LATENCY_LATCHED,    // ports latched into the machine
+  LATENCY_READ,       // game read port 1 or 2
+  LATENCY_CONVERTED,  // changed video ram converted to a frame
+};
+
+enum {
+  LATENCY_PRESS_TO_READ,
+  LATENCY_READ_TO_CONVERT,
+  LATENCY_CONVERT_TO_PRESENT,
+  LATENCY_PRESS_TO_PRESENT,
+  LATENCY_INTERVALS,
+};
+
+typedef struct {
+  uint64_t* values;  // nanoseconds
+  uint32_t count, capacity;
+} latency_samples_t;
+
+// one key event is followed at a time, events during a measurement are
+// ignored. stage hands the timestamps between the event loop thread and the
+// emulation thread
+typedef struct latency_t {
+  int stage;
+  uint64_t pressed, read, converted;
+  uint64_t frame;  // number of the frame holding the reaction
+  uint32_t frames_waited;
+  uint64_t vram_hash;  // reaction area of last converted frame
+
+  latency_samples_t samples[LATENCY_INTERVALS];
+  uint32_t dropped;  // events without visible reaction
+} latency_t;
+
+latency_t* create_latency();
+void destroy_latency(latency_t* latency);
+
+// event loop thread
+void latency_key_event(latency_t* latency);
+void latency_frame_presented(latency_t* latency, uint64_t frame);
+
+// emulation thread
+void latency_input_latched(latency_t* latency);
+void latency_input_read(latency_t* latency);
+// vram is MACHINE_VRAM_SIZE bytes of the frame being published, with run
+// ahead the speculative one
+void latency_frame_converted(latency_t* latency,
+                             const uint8_t* vram,
+                             uint64_t frame);
+
+// p50, p99 and max per interval, histogram of press to present
+void latency_report(const latency_t* latency);
+
+#endif  // LATENCY_H
@@ -0,0 +1,85 @@
+// emulation performance counters exported in Prometheus text format. each
+// thread counts into its own block without atomics and publishes it once per
+// frame, a background thread aggregates the blocks every second and writes
+// a file or answers connections on a UNIX domain socket
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define METRICS_THREADS 4
+#define METRICS_INTERVAL_MS 1000
+#define METRICS_TEXT_SIZE 4096
+
+typedef enum {
+  METRIC_FRAMES,            // completed machine_update_state calls
+  METRIC_CYCLES,            // emulated cpu cycles
+  METRIC_UPDATE_STATE_NS,   // host time in machine_update_state
+  METRIC_SCREEN_BUFFER_NS,  // host time converting video ram
+  METRIC_RENDER_NS,         // host time uploading and presenting a frame
+  METRIC_PRESENTED_FRAMES,  // frames shown by the renderer
+  METRIC_DROPPED_FRAMES,    // emulated frames replaced before being shown
+  METRIC_IDLE_SKIPS,        // render loop passes without a new frame
+  METRIC_SKIPPED_FRAMES,    // emulated frames never converted, frame skip
+  METRIC_SOUND_OVERRUNS,    // mixed samples dropped, audio ring was full
+  METRIC_SOUND_UNDERRUNS,   // silent samples played, audio ring was empty
+  METRIC_COUNT,
+} metric_t;
+
+typedef enum {
+  METRICS_FILE,    // rewritten every interval, replaced atomically
+  METRICS_SOCKET,  // text is sent to every client that connects
+} metrics_output_t;
+
+typedef struct {
+  uint64_t values[METRIC_COUNT];
+} metrics_counters_t;
+
+// local is only touched by the owning thread. published is guarded by
+// sequence, odd while the owner copies into it, so publishing never waits
+// for the exporter
+typedef struct metrics_thread_t {
+  struct metrics_t* metrics;
+  metrics_counters_t local;
+  metrics_counters_t published;
+  uint32_t sequence;
+} metrics_thread_t;
+
+typedef struct metrics_t {
+  metrics_output_t output;
+  char path[256];  // file name or socket path
+  int listen_fd;
+
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  bool closing;
+  metrics_thread_t threads[METRICS_THREADS];
+  int thread_count;
+
+  // exporter thread, rates are measured between intervals
+  metrics_counters_t previous;
+  uint64_t previous_ns;
+  double frames_per_second, emulated_mhz;
+  char text[METRICS_TEXT_SIZE];
+} metrics_t;
+
+// NULL when the socket could not be created
+metrics_t* create_metrics(const char* path, metrics_output_t output);
+
+// exports a final time and stops the exporter thread
+void destroy_metrics(metrics_t* metrics);
+
+// called before the thread starts counting, NULL when all slots are taken
+metrics_thread_t* metrics_register_thread(metrics_t* metrics);
+
+void metrics_add(metrics_thread_t* thread, metric_t metric, uint64_t value);
+
+// makes the thread's counts visible to the exporter
+void metrics_publish(metrics_thread_t* thread);
+
+uint64_t metrics_now_ns(void);
+
+#endif  // METRICS_H
@@ -0,0 +1,48 @@
+// recording of per-frame input port values, replayed from power-on state
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOVIE_MAGIC "SIMV"
+#define MOVIE_VERSION 2
+#define MOVIE_HEADER_SIZE 32  // magic, version, reserved, frames, runs, board
+#define MOVIE_HEADER_V1_SIZE 16  // without board, still loaded
+#define MOVIE_BOARD_SIZE 16      // board name, zero padded
+#define MOVIE_RUN_SIZE 4         // length (2 bytes), in_port1, in_port2
+
+// consecutive frames with identical port values
+typedef struct {
+  uint16_t length;
+  uint8_t in_port1, in_port2;
+} movie_run_t;
+
+typedef struct {
+  movie_run_t* runs;
+  uint32_t run_count, run_capacity;
+  uint32_t frame_count;
+  char board[MOVIE_BOARD_SIZE];  // recorded on, empty for version 1 movies
+
+  // playback cursor
+  uint32_t cursor_run;
+  uint16_t cursor_offset;
+} movie_t;
+
+movie_t* create_movie();
+void destroy_movie(movie_t* movie);
+
+// appends port values read by the game during one frame
+void movie_record_frame(movie_t* movie, uint8_t in_port1, uint8_t in_port2);
+
+// returns false when all recorded frames have been played
+bool movie_next_frame(movie_t* movie, uint8_t* in_port1, uint8_t* in_port2);
+void movie_rewind(movie_t* movie);
+
+void movie_save(const movie_t* movie, const char* file_name);
+movie_t* movie_load(const char* file_name);
+
+#endif  // MOVIE_H
@@ -0,0 +1,26 @@
+// integer scaling of RGB frames on the cpu, written straight into a locked
+// streaming texture so the renderer only copies pixels 1:1
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stdint.h>
+#include "arcade_machine/arcade_machine.h"
+
+#define SCALER_MIN_FACTOR 2
+#define SCALER_MAX_FACTOR 4
+
+typedef enum {
+  SCALER_NEAREST,    // every pixel becomes a factor x factor block
+  SCALER_SCANLINES,  // the last row of every block at half brightness
+} scaler_filter_t;
+
+// scales an RGB24 frame laid out like machine_frame_t into
+// MACHINE_SCREEN_WIDTH * factor by MACHINE_SCREEN_HEIGHT * factor pixels, rows
+// are pitch bytes apart
+void scale_frame(const uint8_t* frame,
+                 int factor,
+                 scaler_filter_t filter,
+                 uint8_t* pixels,
+                 int pitch);
+
+#endif  // SCALER_H
@@ -0,0 +1,84 @@
+// sample based sound effects triggered by output ports 3 and 5
+#ifndef SOUND_H
+#define SOUND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOUND_RATE 44100
+#define SOUND_EFFECTS 9
+#define SOUND_BLOCK 256          // samples mixed per chunk
+#define SOUND_RING_SIZE 8192     // ~190 ms, power of two
+#define SOUND_DIRECTORY "res/sounds"  // 0.wav to 8.wav
+#define SOUND_WAV_HEADER_SIZE 44
+#define SOUND_WAV_BUFFER (1 << 16)  // stdio buffer of wav output
+
+// mono 16-bit pcm at SOUND_RATE
+typedef struct {
+  int16_t* data;
+  uint32_t length;
+} sound_sample_t;
+
+typedef struct {
+  bool playing;
+  uint32_t position;
+} sound_voice_t;
+
+// single producer, single consumer. head is advanced by the emulation thread,
+// tail by the audio callback, neither ever blocks
+typedef struct {
+  int16_t* samples;
+  uint32_t mask;
+  uint64_t head, tail;
+
+  // underruns are counted atomically so the producer can read them
+  uint64_t overruns;   // samples dropped by producer, ring was full
+  uint64_t underruns;  // samples of silence inserted by consumer
+} sound_ring_t;
+
+typedef struct sound_t {
+  sound_sample_t effects[SOUND_EFFECTS];
+  sound_voice_t voices[SOUND_EFFECTS];
+  uint8_t port3, port5;  // last written values
+
+  uint64_t position;  // samples mixed since power-on
+
+  sound_ring_t* ring;  // receives mixed output when set
+  FILE* wav;           // receives mixed output when set, see sound_wav_create
+} sound_t;
+
+sound_t* create_sound();
+void destroy_sound(sound_t* sound);
+
+// loads 0.wav to 8.wav from directory, missing effects stay silent. returns
+// number of effects loaded
+int sound_load_effects(sound_t* sound, const char* directory);
+
+// cycles counts machine clock cycles since power-on. output is mixed up to the
+// write before the port value takes effect
+void sound_port_write(sound_t* sound,
+                      uint8_t port,
+                      uint8_t value,
+                      uint64_t cycles);
+
+// mixes output up to cycles, called at end of frame
+void sound_advance(sound_t* sound, uint64_t cycles);
+
+sound_ring_t* create_sound_ring(uint32_t capacity);
+void destroy_sound_ring(sound_ring_t* ring);
+
+// return number of samples transferred
+uint32_t sound_ring_push(sound_ring_t* ring,
+                         const int16_t* samples,
+                         uint32_t count);
+uint32_t sound_ring_pop(sound_ring_t* ring, int16_t* samples, uint32_t count);
+
+// streaming 16-bit mono wav output. sizes in the header are written on close
+FILE* sound_wav_create(const char* file_name);
+void sound_wav_append(FILE* wav, const int16_t* samples, uint32_t count);
+void sound_wav_close(FILE* wav);
+
+#endif  // SOUND_H
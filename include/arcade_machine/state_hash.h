@@ -0,0 +1,25 @@
+// 64-bit hashing of machine state, streamed once per frame to a binary log
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STATE_HASH_MAGIC "SIHS"
+#define STATE_HASH_VERSION 1
+#define STATE_HASH_HEADER_SIZE 8  // magic, version
+
+// XXH64 compatible; four independent lanes consume 32 bytes per iteration
+uint64_t state_hash64(const void* data, size_t length, uint64_t seed);
+
+// log file holds header followed by one little endian hash per frame
+FILE* state_hash_log_create(const char* file_name);
+FILE* state_hash_log_open(const char* file_name);
+void state_hash_log_append(FILE* log, uint64_t hash);
+bool state_hash_log_next(FILE* log, uint64_t* hash);
+
+#endif  // STATE_HASH_H
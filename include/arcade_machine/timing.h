@@ -0,0 +1,69 @@
+// per-stage frame timing. every thread records spans into its own ring, the
+// rings are read for rolling histograms and a Chrome trace-event JSON of the
+// last seconds, viewable in chrome://tracing or Perfetto
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMING_THREADS 4
+#define TIMING_DEFAULT_SPANS (1 << 16)  // per thread, power of two
+#define TIMING_DEFAULT_WINDOW 5000000000ULL  // nanoseconds in a trace dump
+#define TIMING_HISTOGRAM_BUCKETS 16  // powers of two microseconds
+#define TIMING_HISTOGRAM_WIDTH 40
+
+typedef enum {
+  TIMING_INPUT,       // event handling and input latch
+  TIMING_EMULATION,   // machine_update_state
+  TIMING_CONVERSION,  // video ram to RGB, including run-ahead
+  TIMING_UPLOAD,      // texture upload
+  TIMING_PRESENT,     // copy and present
+  TIMING_STAGES,
+} timing_stage_t;
+
+typedef struct {
+  uint64_t start;     // nanoseconds, monotonic clock
+  uint32_t duration;  // nanoseconds
+  uint8_t stage;
+} timing_span_t;
+
+// single producer like the instruction trace, head is published with release
+// semantics and readers copy the spans that were not overwritten
+typedef struct {
+  const char* name;
+  timing_span_t* spans;
+  uint32_t mask;
+  uint64_t head;  // spans recorded since creation
+} timing_thread_t;
+
+typedef struct {
+  timing_thread_t threads[TIMING_THREADS];
+  int thread_count;
+  uint32_t capacity;
+  uint64_t origin;  // creation, trace timestamps are relative to it
+} timing_t;
+
+timing_t* create_timing(uint32_t capacity);
+void destroy_timing(timing_t* timing);
+
+// called before the thread starts recording, NULL when all slots are taken
+timing_thread_t* timing_register_thread(timing_t* timing, const char* name);
+
+uint64_t timing_now_ns(void);
+
+// records a span from start until now and returns now, so consecutive stages
+// chain without reading the clock twice
+uint64_t timing_record(timing_thread_t* thread,
+                       timing_stage_t stage,
+                       uint64_t start);
+
+// p50, p99, max and a histogram per stage over the spans still in the rings
+void timing_report(const timing_t* timing);
+
+// spans that ended during the last window nanoseconds as trace-event JSON
+bool timing_write_trace(const timing_t* timing,
+                        const char* file_name,
+                        uint64_t window);
+
+#endif  // TIMING_H
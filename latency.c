@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+
+#include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/latency.h"
+#include "arcade_machine/state_hash.h"
+
+#define LATENCY_HISTOGRAM_BUCKET 4000000  // 4 ms
+#define LATENCY_HISTOGRAM_BUCKETS 16
+#define LATENCY_HISTOGRAM_WIDTH 50
+
+static const char* INTERVAL_NAMES[LATENCY_INTERVALS] = {
+    "press to read",
+    "read to convert",
+    "convert to present",
+    "press to present",
+};
+
+static uint64_t now_ns() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static void append_sample(latency_samples_t* samples, uint64_t value) {
+  if (samples->count == samples->capacity) {
+    samples->capacity = samples->capacity ? samples->capacity * 2 : 64;
+    samples->values =
+        realloc(samples->values, samples->capacity * sizeof(uint64_t));
+  }
+
+  samples->values[samples->count++] = value;
+}
+
+static int compare_u64(const void* a, const void* b) {
+  const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// nearest rank on sorted values
+static uint64_t percentile(const uint64_t* sorted, uint32_t count, int p) {
+  const uint32_t rank = (uint32_t)(((uint64_t)count * p + 99) / 100);
+  return sorted[rank ? rank - 1 : 0];
+}
+
+// a change here is taken as the reaction. invader bombs and explosions in
+// the area change it without input too, so measured times are a lower bound
+static uint64_t reaction_hash(const uint8_t* vram) {
+  uint8_t area[MACHINE_VISIBLE_LINES * LATENCY_REACTION_BYTES];
+
+  for (int line = 0; line < MACHINE_VISIBLE_LINES; line++)
+    memcpy(&area[line * LATENCY_REACTION_BYTES],
+           &vram[line * MACHINE_LINE_BYTES],
+           LATENCY_REACTION_BYTES);
+
+  return state_hash64(area, sizeof(area), 0);
+}
+
+latency_t* create_latency() {
+  latency_t* latency = calloc(1, sizeof(latency_t));
+
+  return latency;
+}
+
+void destroy_latency(latency_t* latency) {
+  for (int i = 0; i < LATENCY_INTERVALS; i++)
+    free(latency->samples[i].values);
+  free(latency);
+}
+
+void latency_key_event(latency_t* latency) {
+  if (__atomic_load_n(&latency->stage, __ATOMIC_ACQUIRE) != LATENCY_IDLE)
+    return;
+
+  latency->pressed = now_ns();
+  __atomic_store_n(&latency->stage, LATENCY_PRESSED, __ATOMIC_RELEASE);
+}
+
+void latency_input_latched(latency_t* latency) {
+  if (__atomic_load_n(&latency->stage, __ATOMIC_ACQUIRE) == LATENCY_PRESSED)
+    __atomic_store_n(&latency->stage, LATENCY_LATCHED, __ATOMIC_RELAXED);
+}
+
+void latency_input_read(latency_t* latency) {
+  if (__atomic_load_n(&latency->stage, __ATOMIC_RELAXED) != LATENCY_LATCHED)
+    return;
+
+  latency->read = now_ns();
+  latency->frames_waited = 0;
+  __atomic_store_n(&latency->stage, LATENCY_READ, __ATOMIC_RELAXED);
+}
+
+void latency_frame_converted(latency_t* latency,
+                             const uint8_t* vram,
+                             uint64_t frame) {
+  const uint64_t hash = reaction_hash(vram);
+  const bool changed = hash != latency->vram_hash;
+  latency->vram_hash = hash;
+
+  if (__atomic_load_n(&latency->stage, __ATOMIC_RELAXED) != LATENCY_READ)
+    return;
+
+  if (changed) {
+    latency->converted = now_ns();
+    latency->frame = frame;
+    __atomic_store_n(&latency->stage, LATENCY_CONVERTED, __ATOMIC_RELEASE);
+  } else if (++latency->frames_waited > LATENCY_MAX_FRAMES) {
+    latency->dropped++;
+    __atomic_store_n(&latency->stage, LATENCY_IDLE, __ATOMIC_RELEASE);
+  }
+}
+
+void latency_frame_presented(latency_t* latency, uint64_t frame) {
+  if (__atomic_load_n(&latency->stage, __ATOMIC_ACQUIRE) != LATENCY_CONVERTED ||
+      frame < latency->frame)
+    return;
+
+  const uint64_t presented = now_ns();
+  append_sample(&latency->samples[LATENCY_PRESS_TO_READ],
+                latency->read - latency->pressed);
+  append_sample(&latency->samples[LATENCY_READ_TO_CONVERT],
+                latency->converted - latency->read);
+  append_sample(&latency->samples[LATENCY_CONVERT_TO_PRESENT],
+                presented - latency->converted);
+  append_sample(&latency->samples[LATENCY_PRESS_TO_PRESENT],
+                presented - latency->pressed);
+
+  __atomic_store_n(&latency->stage, LATENCY_IDLE, __ATOMIC_RELEASE);
+}
+
+void latency_report(const latency_t* latency) {
+  printf("\ninput latency, %u key events measured, %u without visible reaction\n",
+         latency->samples[0].count, latency->dropped);
+  printf("reaction is the first change near the cannon, times are a lower "
+         "bound\n");
+  if (latency->samples[0].count == 0)
+    return;
+
+  printf("%-20s %10s %10s %10s\n", "interval (ms)", "p50", "p99", "max");
+
+  uint64_t* sorted = malloc(latency->samples[0].count * sizeof(uint64_t));
+  for (int i = 0; i < LATENCY_INTERVALS; i++) {
+    const latency_samples_t* samples = &latency->samples[i];
+    memcpy(sorted, samples->values, samples->count * sizeof(uint64_t));
+    qsort(sorted, samples->count, sizeof(uint64_t), compare_u64);
+
+    printf("%-20s %10.2f %10.2f %10.2f\n", INTERVAL_NAMES[i],
+           percentile(sorted, samples->count, 50) / 1e6,
+           percentile(sorted, samples->count, 99) / 1e6,
+           sorted[samples->count - 1] / 1e6);
+  }
+  free(sorted);
+
+  // press to present, last bucket collects everything above
+  uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS] = {0};
+  uint32_t largest = 0;
+  const latency_samples_t* total = &latency->samples[LATENCY_PRESS_TO_PRESENT];
+  for (uint32_t i = 0; i < total->count; i++) {
+    uint64_t bucket = total->values[i] / LATENCY_HISTOGRAM_BUCKET;
+    if (bucket >= LATENCY_HISTOGRAM_BUCKETS)
+      bucket = LATENCY_HISTOGRAM_BUCKETS - 1;
+    if (++buckets[bucket] > largest)
+      largest = buckets[bucket];
+  }
+
+  printf("\npress to present\n");
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    const int width = buckets[i] * LATENCY_HISTOGRAM_WIDTH / largest;
+    printf("%3d ms%s %6u ", i * LATENCY_HISTOGRAM_BUCKET / 1000000,
+           i == LATENCY_HISTOGRAM_BUCKETS - 1 ? "+" : " ", buckets[i]);
+    for (int x = 0; x < width; x++)
+      printf("#");
+    printf("\n");
+  }
+}
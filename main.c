@@ -1,24 +1,85 @@
 #include <SDL2/SDL.h>
+#include <inttypes.h>
 
 #include "arcade_machine/arcade_machine.h"
-
-#define WINDOW_WIDTH MACHINE_SCREEN_WIDTH * 3
-#define WINDOW_HEIGHT MACHINE_SCREEN_HEIGHT * 3
+#include "arcade_machine/board.h"
+#include "arcade_machine/capture.h"
+#include "arcade_machine/debug_server.h"
+#include "arcade_machine/frame_queue.h"
+#include "arcade_machine/latency.h"
+#include "arcade_machine/metrics.h"
+#include "arcade_machine/movie.h"
+#include "arcade_machine/scaler.h"
+#include "arcade_machine/sound.h"
+#include "arcade_machine/state_hash.h"
+#include "arcade_machine/timing.h"
+#include "i8080/profile.h"
+#include "i8080/trace.h"
+
+#define WINDOW_SCALE 3  // when SDL scales the texture
+#define MAX_RUN_AHEAD 2
+#define MAX_FRAME_SKIP 4  // frames in a row, the screen still updates at 12fps
+#define FRAME_SKIP_AUTO -1
 
 // SDL components
 static SDL_Window* window;
 static SDL_Renderer* renderer;
 static SDL_Texture* texture;
+static int scale;  // cpu scaling factor, 0 leaves scaling to SDL
+static scaler_filter_t filter;
 
 static machine_t* machine;
-static uint8_t app_should_run = 1;
+static int app_should_run = 1;  // cleared by either thread
+
+// emulation runs on its own thread, frames are handed to the renderer here
+static SDL_Thread* emulation_thread;
+static frame_queue_t* frames;
+
+// written by the event loop, latched into the machine at frame start
+static uint8_t input_port1;  // power-on values of the board
+static uint8_t input_port2;
+
+// input recording and playback
+static movie_t* movie;
+static const char* record_file;
+static const char* play_file;
+static const machine_board_t* board;
+static const char* hash_file;
+static const char* trace_file;
+static bool profile;
+static bool scanline;
+static int frame_skip;  // frames skipped after each drawn one, or automatic
+static int skipped_in_row;
+static uint64_t emulated_frames, skipped_frames;
+static int run_ahead;  // frames emulated ahead of the real one for display
+static uint8_t run_ahead_vram[MACHINE_VRAM_SIZE];  // of the frame shown
+static latency_t* latency;
+static capture_t* capture;
+static debug_server_t* debug_server;
+static metrics_t* metrics;
+static metrics_thread_t* render_metrics;  // counters of the main thread
+static uint64_t next_frame_number;        // to count dropped frames
+static const char* timing_file;
+static timing_t* timing;
+static timing_thread_t* emulation_timing;
+static timing_thread_t* render_timing;
+
+// mixed by the emulation thread, played by the SDL audio callback
+static bool mute;
+static sound_t* sound;
+static sound_ring_t* sound_ring;
+static SDL_AudioDeviceID audio_device;
+static uint64_t counted_overruns, counted_underruns;  // already in metrics
 
 void init_sdl_components() {
   SDL_Init(SDL_INIT_EVERYTHING);
 
-  window = SDL_CreateWindow("Space Invaders", SDL_WINDOWPOS_UNDEFINED,
-                            SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH,
-                            WINDOW_HEIGHT, SDL_WINDOW_RESIZABLE);
+  const int window_scale = scale ? scale : WINDOW_SCALE;
+  window = SDL_CreateWindow(board->title, SDL_WINDOWPOS_UNDEFINED,
+                            SDL_WINDOWPOS_UNDEFINED,
+                            MACHINE_SCREEN_WIDTH * window_scale,
+                            MACHINE_SCREEN_HEIGHT * window_scale,
+                            SDL_WINDOW_RESIZABLE);
 
   if (window == NULL) {
     printf("Could not create window: %s\n", SDL_GetError());
@@ -33,9 +94,12 @@ void init_sdl_components() {
     exit(0);
   }
 
+  // scaled frames are written into the texture at full size
+  const int texture_scale = scale ? scale : 1;
   texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB24,
-                              SDL_TEXTUREACCESS_STREAMING, MACHINE_SCREEN_WIDTH,
-                              MACHINE_SCREEN_HEIGHT);
+                              SDL_TEXTUREACCESS_STREAMING,
+                              MACHINE_SCREEN_WIDTH * texture_scale,
+                              MACHINE_SCREEN_HEIGHT * texture_scale);
 
   if (texture == NULL) {
     printf("Could not create texture: %s\n", SDL_GetError());
@@ -49,109 +113,513 @@ void destroy_sdl_components() {
   SDL_Quit();
 }
 
+static void press(uint8_t* port, uint8_t mask) {
+  __atomic_fetch_or(port, mask, __ATOMIC_RELAXED);
+}
+
+static void release(uint8_t* port, uint8_t mask) {
+  __atomic_fetch_and(port, ~mask, __ATOMIC_RELAXED);
+}
+
+static void stop() {
+  __atomic_store_n(&app_should_run, 0, __ATOMIC_RELAXED);
+}
+
+static bool running() {
+  return __atomic_load_n(&app_should_run, __ATOMIC_RELAXED);
+}
+
+void audio_callback(void* userdata, uint8_t* stream, int length) {
+  int16_t* samples = (int16_t*)stream;
+  const uint32_t count = length / sizeof(int16_t);
+  const uint32_t read = sound_ring_pop(sound_ring, samples, count);
+
+  memset(&samples[read], 0, (count - read) * sizeof(int16_t));  // underrun
+}
+
+void init_audio() {
+  sound = create_sound();
+  if (sound_load_effects(sound, SOUND_DIRECTORY) == 0)
+    printf("No sound effects found in %s\n", SOUND_DIRECTORY);
+
+  SDL_AudioSpec want = {0};
+  want.freq = SOUND_RATE;
+  want.format = AUDIO_S16SYS;
+  want.channels = 1;
+  want.samples = 512;
+  want.callback = audio_callback;
+
+  sound_ring = create_sound_ring(SOUND_RING_SIZE);
+  audio_device = SDL_OpenAudioDevice(NULL, 0, &want, NULL, 0);
+
+  if (!audio_device) {
+    printf("Could not open audio device: %s\n", SDL_GetError());
+    return;
+  }
+
+  sound->ring = sound_ring;
+  SDL_PauseAudioDevice(audio_device, 0);
+}
+
+void destroy_audio() {
+  if (audio_device)
+    SDL_CloseAudioDevice(audio_device);
+
+  destroy_sound_ring(sound_ring);
+  destroy_sound(sound);
+}
+
 void handle_input() {
   SDL_Event event;
 
   while (SDL_PollEvent(&event)) {
     switch (event.type) {
       case SDL_QUIT:
-        app_should_run = 0;
+        stop();
         break;
 
       case SDL_KEYDOWN:
+        if (latency && !event.key.repeat)
+          latency_key_event(latency);
 
         if (event.key.keysym.sym == SDLK_q)
-          app_should_run = 0;
+          stop();
+
+        if (event.key.keysym.sym == SDLK_t && machine->cpu.trace)
+          i8080_trace_save(machine->cpu.trace, trace_file);  // dump on demand
+
+        if (event.key.keysym.sym == SDLK_f && timing)
+          timing_write_trace(timing, timing_file, TIMING_DEFAULT_WINDOW);
 
         if (event.key.keysym.sym == SDLK_c)
-          machine->in_port1 |= (1 << 0);  // coin deposit
+          press(&input_port1, 1 << 0);  // coin deposit
 
         if (event.key.keysym.sym == SDLK_2)
-          machine->in_port1 |= (1 << 1);  // 2P start
+          press(&input_port1, 1 << 1);  // 2P start
 
         if (event.key.keysym.sym == SDLK_RETURN)
-          machine->in_port1 |= (1 << 2);  // 1P start
+          press(&input_port1, 1 << 2);  // 1P start
 
         if (event.key.keysym.sym == SDLK_SPACE) {
-          machine->in_port1 |= (1 << 4);  // 1P shot
-          machine->in_port2 |= (1 << 4);  // 2P shot
+          press(&input_port1, 1 << 4);  // 1P shot
+          press(&input_port2, 1 << 4);  // 2P shot
         }
 
         if (event.key.keysym.sym == SDLK_LEFT) {
-          machine->in_port1 |= (1 << 5);  // 1P left
-          machine->in_port2 |= (1 << 5);  // 2P left
+          press(&input_port1, 1 << 5);  // 1P left
+          press(&input_port2, 1 << 5);  // 2P left
         }
 
         if (event.key.keysym.sym == SDLK_RIGHT) {
-          machine->in_port1 |= (1 << 6);  // 1P right
-          machine->in_port2 |= (1 << 6);  // 2P right
+          press(&input_port1, 1 << 6);  // 1P right
+          press(&input_port2, 1 << 6);  // 2P right
         }
         break;
 
       case SDL_KEYUP:
         if (event.key.keysym.sym == SDLK_c)
-          machine->in_port1 &= ~(1 << 0);  // coin deposit
+          release(&input_port1, 1 << 0);  // coin deposit
 
         if (event.key.keysym.sym == SDLK_2)
-          machine->in_port1 &= ~(1 << 1);  // 2P start
+          release(&input_port1, 1 << 1);  // 2P start
 
         if (event.key.keysym.sym == SDLK_RETURN)
-          machine->in_port1 &= ~(1 << 2);  // 1P start
+          release(&input_port1, 1 << 2);  // 1P start
 
         if (event.key.keysym.sym == SDLK_SPACE) {
-          machine->in_port1 &= ~(1 << 4);  // 1P shot
-          machine->in_port2 &= ~(1 << 4);  // 2P shot
+          release(&input_port1, 1 << 4);  // 1P shot
+          release(&input_port2, 1 << 4);  // 2P shot
         }
 
         if (event.key.keysym.sym == SDLK_LEFT) {
-          machine->in_port1 &= ~(1 << 5);  // 1P left
-          machine->in_port2 &= ~(1 << 5);  // 2P left
+          release(&input_port1, 1 << 5);  // 1P left
+          release(&input_port2, 1 << 5);  // 2P left
         }
 
         if (event.key.keysym.sym == SDLK_RIGHT) {
-          machine->in_port1 &= ~(1 << 6);  // 1P right
-          machine->in_port2 &= ~(1 << 6);  // 2P right
+          release(&input_port1, 1 << 6);  // 1P right
+          release(&input_port2, 1 << 6);  // 2P right
         }
-
-        machine->in_port1 |= (1 << 3);  // reset bit3. should always be set.
         break;
     }
   }
 }
 
-void render() {
+void upload(machine_frame_t* frame) {
+  if (scale) {
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0) {
+      scale_frame((const uint8_t*)frame, scale, filter, pixels, pitch);
+      SDL_UnlockTexture(texture);
+    }
+    return;
+  }
+
   const uint32_t pitch = sizeof(uint8_t) * 3 * MACHINE_SCREEN_WIDTH;
-  SDL_UpdateTexture(texture, NULL, &machine->screen_buffer, pitch);
+  SDL_UpdateTexture(texture, NULL, frame, pitch);
+}
 
+void present() {
   SDL_RenderClear(renderer);
-  SDL_RenderCopy(renderer, texture, NULL, NULL);
+
+  if (scale) {
+    // copied 1:1 and centered, a software renderer does no scaling
+    int width, height;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    const SDL_Rect target = {(width - MACHINE_SCREEN_WIDTH * scale) / 2,
+                             (height - MACHINE_SCREEN_HEIGHT * scale) / 2,
+                             MACHINE_SCREEN_WIDTH * scale,
+                             MACHINE_SCREEN_HEIGHT * scale};
+    SDL_RenderCopy(renderer, texture, NULL, &target);
+  } else {
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+  }
+
   SDL_RenderPresent(renderer);
 }
 
-int main() {
+// spans are only taken with --timing, returns the end of the span
+static uint64_t record_span(timing_thread_t* thread,
+                            timing_stage_t stage,
+                            uint64_t start) {
+  return thread ? timing_record(thread, stage, start) : 0;
+}
+
+static uint64_t span_start() {
+  return timing ? timing_now_ns() : 0;
+}
+
+// frames numbers skipped since the last presented one were dropped
+static void count_presented(uint64_t start_ns, uint64_t frame_number) {
+  metrics_add(render_metrics, METRIC_RENDER_NS, metrics_now_ns() - start_ns);
+  metrics_add(render_metrics, METRIC_PRESENTED_FRAMES, 1);
+  metrics_add(render_metrics, METRIC_DROPPED_FRAMES,
+              frame_number - next_frame_number);
+  next_frame_number = frame_number + 1;
+  metrics_publish(render_metrics);
+}
+
+static void count_idle_skip() {
+  metrics_add(render_metrics, METRIC_IDLE_SKIPS, 1);
+  metrics_publish(render_metrics);
+}
+
+// the audio callback has no metrics block, the emulation thread moves the
+// ring's counts into its own, published with the next frame
+static void count_sound_ring() {
+  const uint64_t overruns = sound_ring->overruns;
+  const uint64_t underruns =
+      __atomic_load_n(&sound_ring->underruns, __ATOMIC_RELAXED);
+
+  metrics_add(machine->metrics, METRIC_SOUND_OVERRUNS,
+              overruns - counted_overruns);
+  metrics_add(machine->metrics, METRIC_SOUND_UNDERRUNS,
+              underruns - counted_underruns);
+  counted_overruns = overruns;
+  counted_underruns = underruns;
+}
+
+// latches port values for the upcoming frame, from movie or keyboard
+void update_movie() {
+  machine->in_port1 = __atomic_load_n(&input_port1, __ATOMIC_RELAXED);
+  machine->in_port2 = __atomic_load_n(&input_port2, __ATOMIC_RELAXED);
+  if (latency)
+    latency_input_latched(latency);
+
+  if (play_file) {
+    if (!movie_next_frame(movie, &machine->in_port1, &machine->in_port2))
+      stop();
+  } else if (record_file) {
+    movie_record_frame(movie, machine->in_port1, machine->in_port2);
+  }
+}
+
+// a fixed skip draws one frame in frame_skip + 1. the automatic one skips
+// while emulation starts a frame or more late, so it catches up in real time.
+// skipped frames are still emulated, only conversion and display are saved
+static bool skip_frame(uint64_t now, uint64_t deadline, uint64_t frame_ticks) {
+  bool skip;
+  if (frame_skip == FRAME_SKIP_AUTO)
+    skip = now >= deadline + frame_ticks && skipped_in_row < MAX_FRAME_SKIP;
+  else
+    skip = skipped_in_row < frame_skip;
+
+  skipped_in_row = skip ? skipped_in_row + 1 : 0;
+  return skip;
+}
+
+// emulates frames at 60 fps while the main thread presents the latest one,
+// so a blocking vsync present no longer delays emulation
+int emulate(void* data) {
+  const uint64_t frequency = SDL_GetPerformanceFrequency();
+  const uint64_t frame_ticks = frequency / MACHINE_FPS;
+  uint64_t deadline = SDL_GetPerformanceCounter();
+
+  // automatic skipping catches up on short stalls instead of dropping time
+  const uint64_t max_behind =
+      frame_skip == FRAME_SKIP_AUTO ? frame_ticks * (MAX_FRAME_SKIP + 1)
+                                    : frame_ticks;
+
+  while (running()) {
+    const bool skip =
+        frame_skip &&
+        skip_frame(SDL_GetPerformanceCounter(), deadline, frame_ticks);
+
+    uint64_t span = span_start();
+    update_movie();
+    span = record_span(emulation_timing, TIMING_INPUT, span);
+
+    // scanline conversion happens during the frame, a skipped one is redrawn
+    // in full by the next drawn frame
+    machine->scanline = scanline && !skip;
+    machine_update_state(machine);
+    span = record_span(emulation_timing, TIMING_EMULATION, span);
+    emulated_frames++;
+
+    if (machine->metrics && machine->sound && machine->sound->ring)
+      count_sound_ring();
+
+    // video captures keep every frame
+    if (capture)
+      capture_frame(capture, machine->memory);
+
+    if (skip) {
+      skipped_frames++;
+      if (machine->metrics)
+        metrics_add(machine->metrics, METRIC_SKIPPED_FRAMES, 1);
+    } else {
+      // the reaction is looked for in the frame shown, the speculative one
+      // with run ahead
+      const uint8_t* shown = &machine->memory[MACHINE_VRAM_START];
+      if (run_ahead) {
+        machine_run_ahead(machine, run_ahead, *frame_queue_back(frames),
+                          latency ? run_ahead_vram : NULL);
+        shown = run_ahead_vram;
+      } else {
+        machine_render_to(machine, *frame_queue_back(frames));
+      }
+      record_span(emulation_timing, TIMING_CONVERSION, span);
+      if (latency)
+        latency_frame_converted(latency, shown, frames->published);
+      frame_queue_publish(frames);
+    }
+
+    deadline += frame_ticks;
+    const uint64_t now = SDL_GetPerformanceCounter();
+    if (now < deadline)
+      SDL_Delay((deadline - now) * 1000 / frequency);
+    else if (now - deadline > max_behind)
+      deadline = now;  // fell behind, e.g. window dragged, don't catch up
+  }
+
+  return 0;
+}
+
+void parse_arguments(int argc, char* argv[]) {
+  const char* board_name = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+      record_file = argv[++i];
+    else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc)
+      play_file = argv[++i];
+    else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc)
+      hash_file = argv[++i];
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+      trace_file = argv[++i];
+    else if (strcmp(argv[i], "--profile") == 0)
+      profile = true;
+    else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc)
+      board_name = argv[++i];
+    else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+      capture = create_capture(argv[++i]);
+    else if (strcmp(argv[i], "--debug-server") == 0 && i + 1 < argc &&
+             (debug_server = create_debug_server(argv[i + 1])))
+      i++;
+    else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc && !metrics)
+      metrics = create_metrics(argv[++i], METRICS_FILE);
+    else if (strcmp(argv[i], "--metrics-socket") == 0 && i + 1 < argc &&
+             !metrics && (metrics = create_metrics(argv[i + 1], METRICS_SOCKET)))
+      i++;
+    else if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc)
+      timing_file = argv[++i];
+    else if (strcmp(argv[i], "--scanline") == 0)
+      scanline = true;
+    else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc &&
+             atoi(argv[i + 1]) >= SCALER_MIN_FACTOR &&
+             atoi(argv[i + 1]) <= SCALER_MAX_FACTOR)
+      scale = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--scanline-effect") == 0)
+      filter = SCALER_SCANLINES;
+    else if (strcmp(argv[i], "--frame-skip") == 0 && i + 1 < argc &&
+             strcmp(argv[i + 1], "auto") == 0) {
+      frame_skip = FRAME_SKIP_AUTO;
+      i++;
+    } else if (strcmp(argv[i], "--frame-skip") == 0 && i + 1 < argc &&
+               atoi(argv[i + 1]) >= 0 && atoi(argv[i + 1]) <= MAX_FRAME_SKIP)
+      frame_skip = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--mute") == 0)
+      mute = true;
+    else if (strcmp(argv[i], "--latency") == 0)
+      latency = create_latency();
+    else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc &&
+             atoi(argv[i + 1]) >= 0 && atoi(argv[i + 1]) <= MAX_RUN_AHEAD)
+      run_ahead = atoi(argv[++i]);
+    else {
+      printf(
+          "usage: %s [--record <movie> | --play <movie>] [--hash <log>] "
+          "[--trace <file>] [--profile] [--run-ahead <0-2>] [--latency] "
+          "[--mute] [--capture <file>] [--board <name>] "
+          "[--debug-server <socket>] [--metrics <file> | --metrics-socket "
+          "<socket>] [--timing <file>] [--scanline] [--scale <2-4>] "
+          "[--scanline-effect] [--frame-skip <0-4|auto>]\n",
+          argv[0]);
+      machine_print_boards();
+      printf("capture: .y4m repeats unchanged frames in full, any other "
+             "extension writes a frame archive storing them once\n");
+      exit(0);
+    }
+  }
+
+  if (filter == SCALER_SCANLINES && !scale)
+    scale = WINDOW_SCALE;  // the effect is drawn by the cpu scaler
+
+  if (play_file)
+    movie = movie_load(play_file);
+  else if (record_file)
+    movie = create_movie();
+
+  board = machine_select_board(board_name, movie ? movie->board : NULL);
+  if (!board)
+    exit(EXIT_FAILURE);
+
+  if (record_file)
+    snprintf(movie->board, sizeof(movie->board), "%s", board->name);
+}
+
+int main(int argc, char* argv[]) {
+  parse_arguments(argc, argv);
+
   init_sdl_components();
 
-  machine = create_machine();
-  machine_load_invaders(machine);
+  machine = create_machine(board);
+  machine_load_roms(machine);
+  machine->scanline = scanline;
+  input_port1 = machine->in_port1;
+  input_port2 = machine->in_port2;
 
-  int timer = SDL_GetTicks();
-  while (app_should_run) {
-    handle_input();
+  if (hash_file)
+    machine->hash_log = state_hash_log_create(hash_file);
 
-    if ((SDL_GetTicks() - timer) >
-        (1.0f / MACHINE_FPS) * 1000) {  // executed every 17 ms (60 fps)
+  if (trace_file) {
+    machine->cpu.trace = create_i8080_trace(1 << 16);
+    i8080_trace_dump_on_crash(machine->cpu.trace, trace_file);
+  }
+
+  if (profile)
+    machine->cpu.profile = create_i8080_profile();
 
-      timer = SDL_GetTicks();
+  machine->latency = latency;
 
-      machine_update_state(machine);
+  machine->debug_server = debug_server;
 
-      machine_update_screen_buffer(machine);
+  if (metrics) {
+    machine->metrics = metrics_register_thread(metrics);
+    render_metrics = metrics_register_thread(metrics);
+  }
+
+  if (timing_file) {
+    timing = create_timing(TIMING_DEFAULT_SPANS);
+    emulation_timing = timing_register_thread(timing, "emulation");
+    render_timing = timing_register_thread(timing, "render");
+  }
 
-      render();
+  if (!mute) {
+    init_audio();
+    machine->sound = sound;
+  }
+
+  frames = create_frame_queue();
+  emulation_thread = SDL_CreateThread(emulate, "emulation", NULL);
+
+  while (running()) {
+    uint64_t span = span_start();
+    handle_input();
+    span = record_span(render_timing, TIMING_INPUT, span);
+
+    machine_frame_t* frame = frame_queue_acquire(frames);
+    if (frame) {
+      const uint64_t start_ns = render_metrics ? metrics_now_ns() : 0;
+      upload(frame);
+      span = record_span(render_timing, TIMING_UPLOAD, span);
+      present();
+      record_span(render_timing, TIMING_PRESENT, span);
+      if (latency)
+        latency_frame_presented(latency, frames->numbers[frames->front]);
+      if (render_metrics)
+        count_presented(start_ns, frames->numbers[frames->front]);
+    } else {
+      if (render_metrics)
+        count_idle_skip();
+      SDL_Delay(1);
     }
   }
 
+  // a stopped emulation thread only returns once released
+  if (debug_server)
+    debug_server_shutdown(debug_server);
+  SDL_WaitThread(emulation_thread, NULL);
+
+  if (capture)
+    destroy_capture(capture);
+  destroy_frame_queue(frames);
+
+  if (sound)
+    destroy_audio();
+
   destroy_sdl_components();
+
+  if (machine->hash_log)
+    fclose(machine->hash_log);
+
+  if (machine->cpu.trace) {
+    i8080_trace_save(machine->cpu.trace, trace_file);
+    destroy_i8080_trace(machine->cpu.trace);
+  }
+
+  if (machine->cpu.profile) {
+    i8080_profile_report(machine->cpu.profile, machine->memory);
+    destroy_i8080_profile(machine->cpu.profile);
+  }
+
+  if (metrics)
+    destroy_metrics(metrics);
+
+  if (timing) {
+    timing_write_trace(timing, timing_file, TIMING_DEFAULT_WINDOW);
+    timing_report(timing);
+    destroy_timing(timing);
+  }
+
+  if (debug_server)
+    destroy_debug_server(debug_server);
   destroy_machine(machine);
+
+  if (latency) {
+    latency_report(latency);
+    destroy_latency(latency);
+  }
+
+  if (frame_skip)
+    printf("frame skip: %" PRIu64 " of %" PRIu64 " frames not drawn\n",
+           skipped_frames, emulated_frames);
+
+  if (movie) {
+    if (record_file)
+      movie_save(movie, record_file);
+    destroy_movie(movie);
+  }
+
   return 0;
 }
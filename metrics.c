@@ -0,0 +1,357 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "arcade_machine/metrics.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define METRICS_NS_PER_MS 1000000ULL
+#define METRICS_ACCEPT_BACKOFF_MS 100  // after accept failed, e.g. EMFILE
+
+typedef struct {
+  const char* name;
+  const char* help;
+  bool nanoseconds;  // exported as seconds
+} metric_info_t;
+
+static const metric_info_t METRIC_INFO[METRIC_COUNT] = {
+    {"invaders_frames_total", "Emulated frames.", false},
+    {"invaders_cycles_total", "Emulated cpu cycles.", false},
+    {"invaders_update_state_seconds_total",
+     "Host time spent in machine_update_state.", true},
+    {"invaders_screen_buffer_seconds_total",
+     "Host time spent converting video ram.", true},
+    {"invaders_render_seconds_total",
+     "Host time spent uploading and presenting frames.", true},
+    {"invaders_presented_frames_total", "Frames shown by the renderer.", false},
+    {"invaders_dropped_frames_total",
+     "Emulated frames replaced before they were shown.", false},
+    {"invaders_idle_skips_total",
+     "Render loop passes without a new frame.", false},
+    {"invaders_skipped_frames_total",
+     "Emulated frames not converted or drawn because of frame skip.", false},
+    {"invaders_sound_overrun_samples_total",
+     "Mixed samples dropped because the audio ring was full.", false},
+    {"invaders_sound_underrun_samples_total",
+     "Samples of silence played because the audio ring was empty.", false},
+};
+
+uint64_t metrics_now_ns(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+static bool is_closing(metrics_t* metrics) {
+  pthread_mutex_lock(&metrics->lock);
+  const bool closing = metrics->closing;
+  pthread_mutex_unlock(&metrics->lock);
+
+  return closing;
+}
+
+// retries while the owner is publishing
+static void read_published(const metrics_thread_t* thread,
+                           metrics_counters_t* counters) {
+  uint32_t before, after;
+
+  do {
+    before = __atomic_load_n(&thread->sequence, __ATOMIC_ACQUIRE);
+    for (int metric = 0; metric < METRIC_COUNT; metric++)
+      counters->values[metric] = __atomic_load_n(
+          &thread->published.values[metric], __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    after = __atomic_load_n(&thread->sequence, __ATOMIC_RELAXED);
+  } while ((before & 1) || before != after);
+}
+
+static void aggregate(metrics_t* metrics, metrics_counters_t* totals) {
+  memset(totals, 0, sizeof(metrics_counters_t));
+
+  pthread_mutex_lock(&metrics->lock);
+  const int thread_count = metrics->thread_count;
+  pthread_mutex_unlock(&metrics->lock);
+
+  for (int thread = 0; thread < thread_count; thread++) {
+    metrics_counters_t counters;
+    read_published(&metrics->threads[thread], &counters);
+
+    for (int metric = 0; metric < METRIC_COUNT; metric++)
+      totals->values[metric] += counters.values[metric];
+  }
+}
+
+static void format_text(metrics_t* metrics, const metrics_counters_t* totals) {
+  char* text = metrics->text;
+  size_t left = sizeof(metrics->text);
+
+  for (int metric = 0; metric < METRIC_COUNT; metric++) {
+    const metric_info_t* info = &METRIC_INFO[metric];
+    const uint64_t value = totals->values[metric];
+    int length;
+
+    if (info->nanoseconds)
+      length = snprintf(text, left,
+                        "# HELP %s %s\n# TYPE %s counter\n%s %.6f\n",
+                        info->name, info->help, info->name, info->name,
+                        value / 1e9);
+    else
+      length = snprintf(text, left,
+                        "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 "\n",
+                        info->name, info->help, info->name, info->name, value);
+
+    // a metric that does not fit is dropped with the ones after it
+    if (length < 0 || (size_t)length >= left) {
+      *text = '\0';
+      return;
+    }
+
+    text += length;
+    left -= length;
+  }
+
+  snprintf(text, left,
+           "# HELP invaders_frames_per_second Emulated frames per second over "
+           "the last interval.\n"
+           "# TYPE invaders_frames_per_second gauge\n"
+           "invaders_frames_per_second %.2f\n"
+           "# HELP invaders_emulated_mhz Emulated cpu clock over the last "
+           "interval.\n"
+           "# TYPE invaders_emulated_mhz gauge\n"
+           "invaders_emulated_mhz %.3f\n",
+           metrics->frames_per_second, metrics->emulated_mhz);
+}
+
+// aggregates the published counters and measures rates since the last call
+static void update(metrics_t* metrics) {
+  metrics_counters_t totals;
+  aggregate(metrics, &totals);
+
+  const uint64_t now = metrics_now_ns();
+  const double seconds = (now - metrics->previous_ns) / 1e9;
+  if (seconds > 0) {
+    metrics->frames_per_second = (totals.values[METRIC_FRAMES] -
+                                  metrics->previous.values[METRIC_FRAMES]) /
+                                 seconds;
+    metrics->emulated_mhz = (totals.values[METRIC_CYCLES] -
+                             metrics->previous.values[METRIC_CYCLES]) /
+                            seconds / 1e6;
+  }
+
+  metrics->previous = totals;
+  metrics->previous_ns = now;
+  format_text(metrics, &totals);
+}
+
+// written next to the target and renamed, readers never see a partial file
+static void write_file(metrics_t* metrics) {
+  char temporary[sizeof(metrics->path) + 4];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", metrics->path);
+
+  FILE* file = fopen(temporary, "w");
+  if (!file)
+    return;
+
+  fputs(metrics->text, file);
+  fclose(file);
+  rename(temporary, metrics->path);
+}
+
+static void serve_until(metrics_t* metrics, uint64_t deadline) {
+  uint64_t now;
+
+  while ((now = metrics_now_ns()) < deadline && !is_closing(metrics)) {
+    struct pollfd listener = {metrics->listen_fd, POLLIN, 0};
+    const int timeout = (deadline - now) / METRICS_NS_PER_MS + 1;
+
+    if (poll(&listener, 1, timeout) <= 0 || !(listener.revents & POLLIN))
+      continue;
+
+    const int fd = accept(metrics->listen_fd, NULL, NULL);
+    if (fd < 0) {
+      // the listener stays readable on errors that persist, poll would spin
+      if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+        const struct timespec backoff = {
+            0, METRICS_ACCEPT_BACKOFF_MS * 1000000L};
+        nanosleep(&backoff, NULL);
+      }
+      continue;
+    }
+
+    // totals are current, rates are from the last interval
+    metrics_counters_t totals;
+    aggregate(metrics, &totals);
+    format_text(metrics, &totals);
+
+    send(fd, metrics->text, strlen(metrics->text), MSG_NOSIGNAL);
+    close(fd);
+  }
+}
+
+static void wait_until(metrics_t* metrics, uint64_t deadline) {
+  const uint64_t now = metrics_now_ns();
+  if (now >= deadline)
+    return;
+
+  // condition variables wait on the realtime clock
+  struct timespec until;
+  clock_gettime(CLOCK_REALTIME, &until);
+  const uint64_t wait = deadline - now + until.tv_nsec;
+  until.tv_sec += wait / 1000000000ULL;
+  until.tv_nsec = wait % 1000000000ULL;
+
+  pthread_mutex_lock(&metrics->lock);
+  if (!metrics->closing)
+    pthread_cond_timedwait(&metrics->changed, &metrics->lock, &until);
+  pthread_mutex_unlock(&metrics->lock);
+}
+
+static void* exporter(void* argument) {
+  metrics_t* metrics = argument;
+  uint64_t next = metrics_now_ns() + METRICS_INTERVAL_MS * METRICS_NS_PER_MS;
+
+  while (!is_closing(metrics)) {
+    if (metrics->output == METRICS_SOCKET)
+      serve_until(metrics, next);
+    else
+      wait_until(metrics, next);
+
+    if (metrics_now_ns() < next)
+      continue;
+
+    update(metrics);
+    if (metrics->output == METRICS_FILE)
+      write_file(metrics);
+    next += METRICS_INTERVAL_MS * METRICS_NS_PER_MS;
+  }
+
+  return NULL;
+}
+
+// a socket left by an earlier run is replaced, anything else at path is kept
+static bool remove_stale_socket(const char* path) {
+  struct stat status;
+  if (lstat(path, &status) < 0)
+    return errno == ENOENT;
+
+  if (!S_ISSOCK(status.st_mode)) {
+    printf("Not a socket, refusing to replace: %s\n", path);
+    return false;
+  }
+
+  return unlink(path) == 0;
+}
+
+static int listen_socket(const char* path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    printf("Metrics socket path too long: %s\n", path);
+    return -1;
+  }
+  strcpy(address.sun_path, path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  if (!remove_stale_socket(path)) {
+    close(fd);
+    return -1;
+  }
+
+  if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+      listen(fd, 4) < 0) {
+    printf("Could not listen on %s\n", path);
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+metrics_t* create_metrics(const char* path, metrics_output_t output) {
+  if (strlen(path) >= sizeof(((metrics_t*)NULL)->path)) {
+    printf("Metrics path too long: %s\n", path);
+    return NULL;
+  }
+
+  int fd = -1;
+  if (output == METRICS_SOCKET && (fd = listen_socket(path)) < 0)
+    return NULL;
+
+  metrics_t* metrics = calloc(1, sizeof(metrics_t));
+  metrics->output = output;
+  strcpy(metrics->path, path);
+  metrics->listen_fd = fd;
+  pthread_mutex_init(&metrics->lock, NULL);
+  pthread_cond_init(&metrics->changed, NULL);
+
+  metrics->previous_ns = metrics_now_ns();
+  update(metrics);
+  pthread_create(&metrics->thread, NULL, exporter, metrics);
+
+  return metrics;
+}
+
+void destroy_metrics(metrics_t* metrics) {
+  pthread_mutex_lock(&metrics->lock);
+  metrics->closing = true;
+  pthread_cond_broadcast(&metrics->changed);
+  pthread_mutex_unlock(&metrics->lock);
+
+  // wakes poll in the exporter thread
+  if (metrics->output == METRICS_SOCKET)
+    shutdown(metrics->listen_fd, SHUT_RDWR);
+  pthread_join(metrics->thread, NULL);
+
+  if (metrics->output == METRICS_FILE) {
+    update(metrics);
+    write_file(metrics);
+  } else {
+    close(metrics->listen_fd);
+    unlink(metrics->path);
+  }
+
+  pthread_cond_destroy(&metrics->changed);
+  pthread_mutex_destroy(&metrics->lock);
+  free(metrics);
+}
+
+metrics_thread_t* metrics_register_thread(metrics_t* metrics) {
+  pthread_mutex_lock(&metrics->lock);
+  metrics_thread_t* thread = NULL;
+  if (metrics->thread_count < METRICS_THREADS) {
+    thread = &metrics->threads[metrics->thread_count++];
+    thread->metrics = metrics;
+  }
+  pthread_mutex_unlock(&metrics->lock);
+
+  return thread;
+}
+
+void metrics_add(metrics_thread_t* thread, metric_t metric, uint64_t value) {
+  thread->local.values[metric] += value;
+}
+
+void metrics_publish(metrics_thread_t* thread) {
+  const uint32_t sequence = thread->sequence;
+
+  __atomic_store_n(&thread->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for (int metric = 0; metric < METRIC_COUNT; metric++)
+    __atomic_store_n(&thread->published.values[metric],
+                     thread->local.values[metric], __ATOMIC_RELAXED);
+  __atomic_store_n(&thread->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,150 @@
+#include "arcade_machine/movie.h"
+
+static void write_u16(uint8_t* buffer, uint16_t value) {
+  buffer[0] = value & 0xff;
+  buffer[1] = value >> 8;
+}
+
+static void write_u32(uint8_t* buffer, uint32_t value) {
+  write_u16(buffer, value & 0xffff);
+  write_u16(buffer + 2, value >> 16);
+}
+
+static uint16_t read_u16(const uint8_t* buffer) {
+  return buffer[0] | (buffer[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t* buffer) {
+  return read_u16(buffer) | ((uint32_t)read_u16(buffer + 2) << 16);
+}
+
+static void append_run(movie_t* movie, uint8_t in_port1, uint8_t in_port2) {
+  if (movie->run_count == movie->run_capacity) {
+    movie->run_capacity = movie->run_capacity ? movie->run_capacity * 2 : 64;
+    movie->runs =
+        realloc(movie->runs, movie->run_capacity * sizeof(movie_run_t));
+  }
+
+  movie_run_t* run = &movie->runs[movie->run_count++];
+  run->length = 0;
+  run->in_port1 = in_port1;
+  run->in_port2 = in_port2;
+}
+
+movie_t* create_movie() {
+  movie_t* movie = calloc(1, sizeof(movie_t));
+
+  return movie;
+}
+
+void destroy_movie(movie_t* movie) {
+  free(movie->runs);
+  free(movie);
+}
+
+void movie_record_frame(movie_t* movie, uint8_t in_port1, uint8_t in_port2) {
+  movie_run_t* last =
+      movie->run_count ? &movie->runs[movie->run_count - 1] : NULL;
+
+  // start new run when ports change or run length would overflow
+  if (!last || last->in_port1 != in_port1 || last->in_port2 != in_port2 ||
+      last->length == UINT16_MAX) {
+    append_run(movie, in_port1, in_port2);
+    last = &movie->runs[movie->run_count - 1];
+  }
+
+  last->length++;
+  movie->frame_count++;
+}
+
+bool movie_next_frame(movie_t* movie, uint8_t* in_port1, uint8_t* in_port2) {
+  if (movie->cursor_run >= movie->run_count)
+    return false;
+
+  const movie_run_t* run = &movie->runs[movie->cursor_run];
+  *in_port1 = run->in_port1;
+  *in_port2 = run->in_port2;
+
+  if (++movie->cursor_offset >= run->length) {
+    movie->cursor_run++;
+    movie->cursor_offset = 0;
+  }
+
+  return true;
+}
+
+void movie_rewind(movie_t* movie) {
+  movie->cursor_run = 0;
+  movie->cursor_offset = 0;
+}
+
+void movie_save(const movie_t* movie, const char* file_name) {
+  FILE* file = fopen(file_name, "wb");
+  if (!file) {
+    printf("Could not write file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  uint8_t header[MOVIE_HEADER_SIZE] = {0};
+  memcpy(header, MOVIE_MAGIC, 4);
+  write_u16(&header[4], MOVIE_VERSION);
+  write_u32(&header[8], movie->frame_count);
+  write_u32(&header[12], movie->run_count);
+  strncpy((char*)&header[16], movie->board, MOVIE_BOARD_SIZE - 1);
+  fwrite(header, sizeof(header), 1, file);
+
+  for (uint32_t i = 0; i < movie->run_count; i++) {
+    uint8_t record[MOVIE_RUN_SIZE];
+    write_u16(&record[0], movie->runs[i].length);
+    record[2] = movie->runs[i].in_port1;
+    record[3] = movie->runs[i].in_port2;
+    fwrite(record, sizeof(record), 1, file);
+  }
+
+  fclose(file);
+}
+
+movie_t* movie_load(const char* file_name) {
+  FILE* file = fopen(file_name, "rb");
+  if (!file) {
+    printf("Could not read file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  uint8_t header[MOVIE_HEADER_SIZE] = {0};
+  if (fread(header, MOVIE_HEADER_V1_SIZE, 1, file) != 1 ||
+      memcmp(header, MOVIE_MAGIC, 4) != 0 ||
+      (read_u16(&header[4]) != 1 && read_u16(&header[4]) != MOVIE_VERSION) ||
+      (read_u16(&header[4]) == MOVIE_VERSION &&
+       fread(&header[MOVIE_HEADER_V1_SIZE],
+             MOVIE_HEADER_SIZE - MOVIE_HEADER_V1_SIZE, 1, file) != 1)) {
+    printf("Not a movie file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  movie_t* movie = create_movie();
+  memcpy(movie->board, &header[16], MOVIE_BOARD_SIZE - 1);
+  const uint32_t run_count = read_u32(&header[12]);
+
+  for (uint32_t i = 0; i < run_count; i++) {
+    uint8_t record[MOVIE_RUN_SIZE];
+    if (fread(record, sizeof(record), 1, file) != 1 ||
+        read_u16(&record[0]) == 0) {
+      printf("Corrupt movie file: %s\n", file_name);
+      exit(EXIT_FAILURE);
+    }
+
+    append_run(movie, record[2], record[3]);
+    movie->runs[movie->run_count - 1].length = read_u16(&record[0]);
+    movie->frame_count += read_u16(&record[0]);
+  }
+
+  fclose(file);
+
+  if (movie->frame_count != read_u32(&header[8])) {
+    printf("Corrupt movie file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  return movie;
+}
@@ -0,0 +1,42 @@
+#include "arcade_machine/scaler.h"
+
+// one source row widened into a destination row, the other rows of the block
+// are copies of it so every source pixel is read once
+static void widen_row(const uint8_t* row, int factor, uint8_t* out) {
+  for (int x = 0; x < MACHINE_SCREEN_WIDTH; x++, row += 3) {
+    for (int i = 0; i < factor; i++) {
+      out[0] = row[0];
+      out[1] = row[1];
+      out[2] = row[2];
+      out += 3;
+    }
+  }
+}
+
+static void dim_row(const uint8_t* row, int length, uint8_t* out) {
+  for (int i = 0; i < length; i++)
+    out[i] = row[i] >> 1;
+}
+
+void scale_frame(const uint8_t* frame,
+                 int factor,
+                 scaler_filter_t filter,
+                 uint8_t* pixels,
+                 int pitch) {
+  const int length = MACHINE_SCREEN_WIDTH * factor * 3;
+  const int copies = filter == SCALER_SCANLINES ? factor - 2 : factor - 1;
+
+  for (int y = 0; y < MACHINE_SCREEN_HEIGHT; y++) {
+    uint8_t* first = pixels;
+    widen_row(&frame[y * MACHINE_SCREEN_WIDTH * 3], factor, first);
+    pixels += pitch;
+
+    for (int i = 0; i < copies; i++, pixels += pitch)
+      memcpy(pixels, first, length);
+
+    if (filter == SCALER_SCANLINES) {
+      dim_row(first, length, pixels);
+      pixels += pitch;
+    }
+  }
+}
@@ -0,0 +1,313 @@
+#include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/sound.h"
+
+#define SOUND_AMP_ENABLE (1 << 5)  // port 3
+#define SOUND_VOLUME 3            // of 4, leaves headroom for mixing
+
+// space invaders sound board, effect i is i.wav
+static const struct {
+  uint8_t port, bit;
+  bool loop;  // plays while bit is set
+} EFFECTS[SOUND_EFFECTS] = {
+    {3, 0, true},   // ufo
+    {3, 1, false},  // shot
+    {3, 2, false},  // player dies
+    {3, 3, false},  // invader dies
+    {5, 0, false},  // fleet movement 1
+    {5, 1, false},  // fleet movement 2
+    {5, 2, false},  // fleet movement 3
+    {5, 3, false},  // fleet movement 4
+    {5, 4, false},  // ufo hit
+};
+
+static void write_u16(uint8_t* buffer, uint16_t value) {
+  buffer[0] = value & 0xff;
+  buffer[1] = value >> 8;
+}
+
+static void write_u32(uint8_t* buffer, uint32_t value) {
+  write_u16(buffer, value & 0xffff);
+  write_u16(buffer + 2, value >> 16);
+}
+
+static uint16_t read_u16(const uint8_t* buffer) {
+  return buffer[0] | (buffer[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t* buffer) {
+  return read_u16(buffer) | ((uint32_t)read_u16(buffer + 2) << 16);
+}
+
+// 8 or 16-bit pcm, mono or stereo, converted to mono at SOUND_RATE
+static bool load_wav(sound_sample_t* sample, const char* file_name) {
+  FILE* file = fopen(file_name, "rb");
+  if (!file)
+    return false;
+
+  fseek(file, 0L, SEEK_END);
+  const long file_size = ftell(file);
+  fseek(file, 0L, SEEK_SET);
+
+  uint8_t* buffer = malloc(file_size);
+  const bool read = fread(buffer, file_size, 1, file) == 1;
+  fclose(file);
+
+  const uint8_t* format = NULL;
+  const uint8_t* data = NULL;
+  uint32_t data_size = 0;
+
+  if (read && file_size >= 12 && memcmp(buffer, "RIFF", 4) == 0 &&
+      memcmp(&buffer[8], "WAVE", 4) == 0) {
+    for (long offset = 12; offset + 8 <= file_size;) {
+      const uint32_t size = read_u32(&buffer[offset + 4]);
+      if (size > file_size - offset - 8)
+        break;
+
+      if (memcmp(&buffer[offset], "fmt ", 4) == 0 && size >= 16)
+        format = &buffer[offset + 8];
+      else if (memcmp(&buffer[offset], "data", 4) == 0) {
+        data = &buffer[offset + 8];
+        data_size = size;
+      }
+
+      offset += 8 + size + (size & 1);  // chunks are word aligned
+    }
+  }
+
+  const uint16_t channels = format ? read_u16(&format[2]) : 0;
+  const uint32_t rate = format ? read_u32(&format[4]) : 0;
+  const uint16_t bits = format ? read_u16(&format[14]) : 0;
+
+  if (!format || !data || read_u16(&format[0]) != 1 || channels < 1 ||
+      channels > 2 || rate == 0 || (bits != 8 && bits != 16)) {
+    printf("Unsupported wav file: %s\n", file_name);
+    free(buffer);
+    return false;
+  }
+
+  const uint32_t frame_size = channels * bits / 8;
+  const uint32_t frames = data_size / frame_size;
+  sample->length = (uint64_t)frames * SOUND_RATE / rate;
+  sample->data = malloc(sample->length * sizeof(int16_t));
+
+  // nearest neighbour resampling, effects are short and low fidelity
+  for (uint32_t i = 0; i < sample->length; i++) {
+    const uint8_t* frame = &data[(uint64_t)i * rate / SOUND_RATE * frame_size];
+    int32_t value = 0;
+
+    for (int channel = 0; channel < channels; channel++) {
+      if (bits == 8)
+        value += (frame[channel] - 128) * 256;
+      else
+        value += (int16_t)read_u16(&frame[channel * 2]);
+    }
+
+    sample->data[i] = value / channels;
+  }
+
+  free(buffer);
+  return true;
+}
+
+static void mix(sound_t* sound, int16_t* output, uint32_t count) {
+  const bool enabled = sound->port3 & SOUND_AMP_ENABLE;
+
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t value = 0;
+
+    for (int effect = 0; effect < SOUND_EFFECTS; effect++) {
+      sound_voice_t* voice = &sound->voices[effect];
+      const sound_sample_t* sample = &sound->effects[effect];
+      if (!voice->playing)
+        continue;
+
+      if (voice->position >= sample->length) {
+        voice->position = 0;
+        voice->playing = EFFECTS[effect].loop && sample->length;
+        if (!voice->playing)
+          continue;
+      }
+
+      value += sample->data[voice->position++];
+    }
+
+    value = enabled ? value * SOUND_VOLUME / 4 : 0;
+    output[i] = value > INT16_MAX ? INT16_MAX
+                : value < INT16_MIN ? INT16_MIN
+                                    : value;
+  }
+}
+
+sound_t* create_sound() {
+  sound_t* sound = calloc(1, sizeof(sound_t));
+
+  return sound;
+}
+
+void destroy_sound(sound_t* sound) {
+  for (int effect = 0; effect < SOUND_EFFECTS; effect++)
+    free(sound->effects[effect].data);
+  free(sound);
+}
+
+int sound_load_effects(sound_t* sound, const char* directory) {
+  int loaded = 0;
+
+  for (int effect = 0; effect < SOUND_EFFECTS; effect++) {
+    char file_name[256];
+    snprintf(file_name, sizeof(file_name), "%s/%d.wav", directory, effect);
+
+    free(sound->effects[effect].data);
+    sound->effects[effect].data = NULL;
+    sound->effects[effect].length = 0;
+
+    loaded += load_wav(&sound->effects[effect], file_name);
+  }
+
+  return loaded;
+}
+
+void sound_port_write(sound_t* sound,
+                      uint8_t port,
+                      uint8_t value,
+                      uint64_t cycles) {
+  sound_advance(sound, cycles);
+
+  uint8_t* latch = port == 3 ? &sound->port3 : &sound->port5;
+  const uint8_t rising = value & ~*latch;
+  *latch = value;
+
+  for (int effect = 0; effect < SOUND_EFFECTS; effect++) {
+    if (EFFECTS[effect].port != port)
+      continue;
+
+    sound_voice_t* voice = &sound->voices[effect];
+    const bool set = value & (1 << EFFECTS[effect].bit);
+
+    if (rising & (1 << EFFECTS[effect].bit)) {
+      voice->playing = sound->effects[effect].length > 0;
+      voice->position = 0;
+    } else if (EFFECTS[effect].loop && !set) {
+      voice->playing = false;
+    }
+  }
+}
+
+void sound_advance(sound_t* sound, uint64_t cycles) {
+  const uint64_t target = cycles * SOUND_RATE / MACHINE_CLOCK_RATE;
+
+  while (sound->position < target) {
+    int16_t block[SOUND_BLOCK];
+    const uint32_t count = target - sound->position < SOUND_BLOCK
+                               ? target - sound->position
+                               : SOUND_BLOCK;
+
+    mix(sound, block, count);
+    sound->position += count;
+
+    if (sound->ring)
+      sound_ring_push(sound->ring, block, count);
+
+    if (sound->wav)
+      sound_wav_append(sound->wav, block, count);
+  }
+}
+
+sound_ring_t* create_sound_ring(uint32_t capacity) {
+  sound_ring_t* ring = calloc(1, sizeof(sound_ring_t));
+
+  ring->samples = calloc(capacity, sizeof(int16_t));
+  ring->mask = capacity - 1;
+
+  return ring;
+}
+
+void destroy_sound_ring(sound_ring_t* ring) {
+  free(ring->samples);
+  free(ring);
+}
+
+uint32_t sound_ring_push(sound_ring_t* ring,
+                         const int16_t* samples,
+                         uint32_t count) {
+  const uint64_t head = ring->head;
+  const uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  const uint32_t space = ring->mask + 1 - (uint32_t)(head - tail);
+  const uint32_t written = count < space ? count : space;
+
+  for (uint32_t i = 0; i < written; i++)
+    ring->samples[(head + i) & ring->mask] = samples[i];
+
+  __atomic_store_n(&ring->head, head + written, __ATOMIC_RELEASE);
+  ring->overruns += count - written;
+  return written;
+}
+
+uint32_t sound_ring_pop(sound_ring_t* ring, int16_t* samples, uint32_t count) {
+  const uint64_t tail = ring->tail;
+  const uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  const uint32_t available = (uint32_t)(head - tail);
+  const uint32_t read = count < available ? count : available;
+
+  for (uint32_t i = 0; i < read; i++)
+    samples[i] = ring->samples[(tail + i) & ring->mask];
+
+  __atomic_store_n(&ring->tail, tail + read, __ATOMIC_RELEASE);
+  __atomic_fetch_add(&ring->underruns, count - read, __ATOMIC_RELAXED);
+  return read;
+}
+
+FILE* sound_wav_create(const char* file_name) {
+  FILE* wav = fopen(file_name, "wb");
+  if (!wav) {
+    printf("Could not write file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+  setvbuf(wav, NULL, _IOFBF, SOUND_WAV_BUFFER);
+
+  // riff and data sizes are filled in by sound_wav_close
+  uint8_t header[SOUND_WAV_HEADER_SIZE] = {0};
+  memcpy(&header[0], "RIFF", 4);
+  memcpy(&header[8], "WAVE", 4);
+  memcpy(&header[12], "fmt ", 4);
+  write_u32(&header[16], 16);                 // fmt chunk size
+  write_u16(&header[20], 1);                  // pcm
+  write_u16(&header[22], 1);                  // mono
+  write_u32(&header[24], SOUND_RATE);         // sample rate
+  write_u32(&header[28], SOUND_RATE * 2);     // bytes per second
+  write_u16(&header[32], 2);                  // bytes per frame
+  write_u16(&header[34], 16);                 // bits per sample
+  memcpy(&header[36], "data", 4);
+  fwrite(header, sizeof(header), 1, wav);
+
+  return wav;
+}
+
+void sound_wav_append(FILE* wav, const int16_t* samples, uint32_t count) {
+  uint8_t buffer[SOUND_BLOCK * 2];
+
+  while (count) {
+    const uint32_t chunk = count < SOUND_BLOCK ? count : SOUND_BLOCK;
+    for (uint32_t i = 0; i < chunk; i++)
+      write_u16(&buffer[i * 2], samples[i]);
+
+    fwrite(buffer, chunk * 2, 1, wav);
+    samples += chunk;
+    count -= chunk;
+  }
+}
+
+void sound_wav_close(FILE* wav) {
+  const long size = ftell(wav);
+  uint8_t field[4];
+
+  write_u32(field, size - 8);
+  fseek(wav, 4, SEEK_SET);
+  fwrite(field, sizeof(field), 1, wav);
+
+  write_u32(field, size - SOUND_WAV_HEADER_SIZE);
+  fseek(wav, 40, SEEK_SET);
+  fwrite(field, sizeof(field), 1, wav);
+
+  fclose(wav);
+}
@@ -0,0 +1,136 @@
+#include "arcade_machine/state_hash.h"
+
+static const uint64_t PRIME1 = 0x9e3779b185ebca87ULL;
+static const uint64_t PRIME2 = 0xc2b2ae3d27d4eb4fULL;
+static const uint64_t PRIME3 = 0x165667b19e3779f9ULL;
+static const uint64_t PRIME4 = 0x85ebca77c2b2ae63ULL;
+static const uint64_t PRIME5 = 0x27d4eb2f165667c5ULL;
+
+static uint64_t rotl(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// little endian loads, independent of host byte order
+static uint64_t read_u64(const uint8_t* p) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; i--)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t round64(uint64_t acc, uint64_t input) {
+  acc += input * PRIME2;
+  acc = rotl(acc, 31);
+  return acc * PRIME1;
+}
+
+static uint64_t merge_round(uint64_t acc, uint64_t lane) {
+  acc ^= round64(0, lane);
+  return acc * PRIME1 + PRIME4;
+}
+
+uint64_t state_hash64(const void* data, size_t length, uint64_t seed) {
+  const uint8_t* p = data;
+  const uint8_t* const end = p + length;
+  uint64_t hash;
+
+  if (length >= 32) {
+    // lanes have no dependency on each other within a stripe
+    uint64_t lanes[4] = {seed + PRIME1 + PRIME2, seed + PRIME2, seed,
+                         seed - PRIME1};
+
+    for (; p + 32 <= end; p += 32) {
+      for (int lane = 0; lane < 4; lane++)
+        lanes[lane] = round64(lanes[lane], read_u64(p + lane * 8));
+    }
+
+    hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) +
+           rotl(lanes[3], 18);
+
+    for (int lane = 0; lane < 4; lane++)
+      hash = merge_round(hash, lanes[lane]);
+  } else {
+    hash = seed + PRIME5;
+  }
+
+  hash += length;
+
+  for (; p + 8 <= end; p += 8) {
+    hash ^= round64(0, read_u64(p));
+    hash = rotl(hash, 27) * PRIME1 + PRIME4;
+  }
+
+  if (p + 4 <= end) {
+    hash ^= read_u32(p) * PRIME1;
+    hash = rotl(hash, 23) * PRIME2 + PRIME3;
+    p += 4;
+  }
+
+  for (; p < end; p++) {
+    hash ^= *p * PRIME5;
+    hash = rotl(hash, 11) * PRIME1;
+  }
+
+  // avalanche
+  hash ^= hash >> 33;
+  hash *= PRIME2;
+  hash ^= hash >> 29;
+  hash *= PRIME3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+FILE* state_hash_log_create(const char* file_name) {
+  FILE* log = fopen(file_name, "wb");
+  if (!log) {
+    printf("Could not write file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  uint8_t header[STATE_HASH_HEADER_SIZE] = {0};
+  memcpy(header, STATE_HASH_MAGIC, 4);
+  header[4] = STATE_HASH_VERSION;
+  fwrite(header, sizeof(header), 1, log);
+
+  return log;
+}
+
+FILE* state_hash_log_open(const char* file_name) {
+  FILE* log = fopen(file_name, "rb");
+  if (!log) {
+    printf("Could not read file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  uint8_t header[STATE_HASH_HEADER_SIZE];
+  if (fread(header, sizeof(header), 1, log) != 1 ||
+      memcmp(header, STATE_HASH_MAGIC, 4) != 0 ||
+      header[4] != STATE_HASH_VERSION) {
+    printf("Not a state hash log: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  return log;
+}
+
+void state_hash_log_append(FILE* log, uint64_t hash) {
+  uint8_t record[8];
+  for (int i = 0; i < 8; i++)
+    record[i] = hash >> (i * 8);
+
+  fwrite(record, sizeof(record), 1, log);
+}
+
+bool state_hash_log_next(FILE* log, uint64_t* hash) {
+  uint8_t record[8];
+  if (fread(record, sizeof(record), 1, log) != 1)
+    return false;
+
+  *hash = read_u64(record);
+  return true;
+}
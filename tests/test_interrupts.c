@@ -0,0 +1,64 @@
+// checks that RST 1 and RST 2 stay on their raster lines over a minute of
+// frames. the scanline renderer places RST 1 at half a frame and RST 2 at the
+// frame end, a schedule drifting against the frame shows up here first
+#include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/board.h"
+#include "i8080/debug.h"
+
+#define TEST_FRAMES 3600  // one minute
+#define TEST_SLACK 21     // JMP still executing, then the RST itself
+
+static const uint8_t PROGRAM[] = {
+    0x31, 0x00, 0x24,  // 0000 LXI SP,$2400
+    0xfb,              // 0003 EI
+    0xc3, 0x04, 0x00,  // 0004 JMP $0004
+    0x00,              //      padding
+    0xfb, 0xc9,        // 0008 EI, RET
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // padding
+    0xfb, 0xc9,        // 0010 EI, RET
+};
+
+int main() {
+  machine_t* machine = create_machine(machine_find_board(MACHINE_DEFAULT_BOARD));
+  memcpy(machine->memory, PROGRAM, sizeof(PROGRAM));
+  machine->cpu.debug = create_i8080_debug();
+  i8080_debug_set(machine->cpu.debug, 0x0008, I8080_DEBUG_BREAK);
+  i8080_debug_set(machine->cpu.debug, 0x0010, I8080_DEBUG_BREAK);
+
+  uint32_t frames = 0, rst1 = 0, rst2 = 0;
+  bool passed = true;
+
+  while (frames < TEST_FRAMES && passed) {
+    if (machine_update_state(machine)) {
+      frames++;
+      continue;
+    }
+
+    // stopped on the handler, cycles counted from the start of the frame
+    const uint64_t elapsed = machine->cpu.cycles -
+                             (machine->frame_deadline - MACHINE_CYCLES_PER_FRAME);
+    if (machine->cpu.pc == 0x0008) {
+      rst1++;
+      passed = elapsed >= MACHINE_HALF_CYCLES_PER_FRAME &&
+               elapsed <= MACHINE_HALF_CYCLES_PER_FRAME + TEST_SLACK;
+    } else {
+      // taken as the previous frame ended, the frame deadline moved on since
+      rst2++;
+      passed = elapsed <= TEST_SLACK;
+    }
+
+    if (!passed)
+      printf("frame %u: RST %d at cycle %llu of the frame\n", frames,
+             machine->cpu.pc == 0x0008 ? 1 : 2, (unsigned long long)elapsed);
+    i8080_debug_resume(machine->cpu.debug);
+  }
+
+  // the RST 2 of the last frame is only seen by the next update
+  passed = passed && rst1 == TEST_FRAMES && rst2 == TEST_FRAMES - 1;
+  printf("interrupts on their lines for %u frames %s\n", frames,
+         passed ? "PASS" : "FAIL");
+
+  destroy_i8080_debug(machine->cpu.debug);
+  destroy_machine(machine);
+  return passed ? 0 : 1;
+}
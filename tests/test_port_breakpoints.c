@@ -0,0 +1,64 @@
+// checks that IN and OUT stop on breakpoints and execute as one step each. the
+// core runs them through its in and out hooks, an IN reached by a jump and an
+// OUT reached by falling through cover both ways into a port instruction
+#include "i8080/debug.h"
+#include "i8080/i8080.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t PROGRAM[] = {
+    0xc3, 0x05, 0x00,  // 0000 JMP $0005
+    0x00, 0x00,        //      padding
+    0xdb, 0x01,        // 0005 IN 1
+    0xd3, 0x02,        // 0007 OUT 2
+    0x76,              // 0009 HLT
+};
+
+static uint8_t test_in(void* io, uint8_t port) {
+  (void)io;
+  return port + 0x40;
+}
+
+static void test_out(void* io, uint8_t port, uint8_t value) {
+  (void)port;
+  *(uint8_t*)io = value;
+}
+
+int main() {
+  i8080_t state;
+  uint8_t out_value = 0;
+  init_i8080(&state);
+  state.external_memory = calloc(1, I8080_MAX_MEMORY);
+  memcpy(state.external_memory, PROGRAM, sizeof(PROGRAM));
+  state.in = test_in;
+  state.out = test_out;
+  state.io = &out_value;
+  state.debug = create_i8080_debug();
+  i8080_debug_set(state.debug, 0x0005, I8080_DEBUG_BREAK);
+  i8080_debug_set(state.debug, 0x0007, I8080_DEBUG_BREAK);
+
+  i8080_step(&state);  // JMP
+  i8080_step(&state);  // stops before IN
+  bool passed = state.debug->stop == I8080_DEBUG_STOP_BREAK && state.pc == 5;
+
+  i8080_debug_resume(state.debug);
+  i8080_step(&state);  // IN
+  passed = passed && state.pc == 7 && state.a == 0x41;
+
+  i8080_step(&state);  // stops before OUT
+  passed = passed && state.debug->stop == I8080_DEBUG_STOP_BREAK &&
+           state.pc == 7 && out_value == 0;
+
+  i8080_debug_resume(state.debug);
+  i8080_step(&state);  // OUT
+  passed = passed && state.pc == 9 && out_value == 0x41 &&
+           state.cycles == 10 + 10 + 10;
+
+  printf("breakpoints on IN and OUT %s\n", passed ? "PASS" : "FAIL");
+
+  destroy_i8080_debug(state.debug);
+  free(state.external_memory);
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "arcade_machine/timing.h"
+#include "i8080/ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* STAGE_NAMES[TIMING_STAGES] = {
+    "input", "emulation", "conversion", "upload", "present",
+};
+
+timing_t* create_timing(uint32_t capacity) {
+  timing_t* timing = calloc(1, sizeof(timing_t));
+  timing->capacity = capacity;
+  timing->origin = timing_now_ns();
+  return timing;
+}
+
+void destroy_timing(timing_t* timing) {
+  for (int i = 0; i < timing->thread_count; i++)
+    free(timing->threads[i].spans);
+  free(timing);
+}
+
+timing_thread_t* timing_register_thread(timing_t* timing, const char* name) {
+  if (timing->thread_count == TIMING_THREADS)
+    return NULL;
+
+  timing_thread_t* thread = &timing->threads[timing->thread_count++];
+  thread->name = name;
+  thread->spans = calloc(timing->capacity, sizeof(timing_span_t));
+  thread->mask = timing->capacity - 1;
+  return thread;
+}
+
+uint64_t timing_now_ns(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+uint64_t timing_record(timing_thread_t* thread,
+                       timing_stage_t stage,
+                       uint64_t start) {
+  const uint64_t end = timing_now_ns();
+  timing_span_t* span = &thread->spans[thread->head & thread->mask];
+
+  span->start = start;
+  span->duration = end - start;
+  span->stage = stage;
+  __atomic_store_n(&thread->head, thread->head + 1, __ATOMIC_RELEASE);
+
+  return end;
+}
+
+// copies the spans of a thread oldest first, dropping any the producer
+// overwrote during the copy
+static uint32_t snapshot(const timing_t* timing,
+                         const timing_thread_t* thread,
+                         timing_span_t* spans) {
+  const uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+  const uint64_t first = head > timing->capacity ? head - timing->capacity : 0;
+
+  for (uint64_t i = first; i < head; i++)
+    spans[i - first] = thread->spans[i & thread->mask];
+
+  const uint64_t after = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+  const uint64_t valid = ring_first_valid(after, timing->capacity);
+  if (valid <= first)
+    return head - first;
+
+  const uint64_t lost = valid - first < head - first ? valid - first
+                                                     : head - first;
+  memmove(spans, &spans[lost], (head - first - lost) * sizeof(timing_span_t));
+  return head - first - lost;
+}
+
+static int compare_u32(const void* a, const void* b) {
+  const uint32_t va = *(const uint32_t*)a;
+  const uint32_t vb = *(const uint32_t*)b;
+
+  return (va > vb) - (va < vb);
+}
+
+static int histogram_bucket(uint32_t duration) {
+  int bucket = 0;
+  for (uint32_t micros = duration / 1000; micros > 1; micros >>= 1)
+    bucket++;
+
+  return bucket < TIMING_HISTOGRAM_BUCKETS ? bucket
+                                           : TIMING_HISTOGRAM_BUCKETS - 1;
+}
+
+static void print_histogram(const uint32_t* durations, uint32_t count) {
+  uint32_t buckets[TIMING_HISTOGRAM_BUCKETS] = {0};
+  uint32_t largest = 0;
+  int lowest = TIMING_HISTOGRAM_BUCKETS, highest = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    const int bucket = histogram_bucket(durations[i]);
+    if (++buckets[bucket] > largest)
+      largest = buckets[bucket];
+    if (bucket < lowest)
+      lowest = bucket;
+    if (bucket > highest)
+      highest = bucket;
+  }
+
+  for (int i = lowest; i <= highest; i++) {
+    const int width = buckets[i] * TIMING_HISTOGRAM_WIDTH / largest;
+    printf("  %6u us%s %8u ", i ? 1u << i : 0,
+           i == TIMING_HISTOGRAM_BUCKETS - 1 ? "+" : " ", buckets[i]);
+    for (int x = 0; x < width; x++)
+      printf("#");
+    printf("\n");
+  }
+}
+
+void timing_report(const timing_t* timing) {
+  timing_span_t* spans = malloc(timing->capacity * sizeof(timing_span_t));
+  uint32_t* durations[TIMING_STAGES];
+  uint32_t counts[TIMING_STAGES] = {0};
+
+  for (int stage = 0; stage < TIMING_STAGES; stage++)
+    durations[stage] =
+        malloc(timing->capacity * timing->thread_count * sizeof(uint32_t));
+
+  for (int i = 0; i < timing->thread_count; i++) {
+    const uint32_t count = snapshot(timing, &timing->threads[i], spans);
+    for (uint32_t span = 0; span < count; span++) {
+      const int stage = spans[span].stage;
+      durations[stage][counts[stage]++] = spans[span].duration;
+    }
+  }
+
+  printf("\nframe timing, recent spans per stage\n");
+  printf("%-12s %8s %10s %10s %10s\n", "stage (ms)", "spans", "p50", "p99",
+         "max");
+  for (int stage = 0; stage < TIMING_STAGES; stage++) {
+    const uint32_t count = counts[stage];
+    if (count == 0)
+      continue;
+
+    qsort(durations[stage], count, sizeof(uint32_t), compare_u32);
+    printf("%-12s %8u %10.3f %10.3f %10.3f\n", STAGE_NAMES[stage], count,
+           durations[stage][count / 2] / 1e6,
+           durations[stage][(uint64_t)(count - 1) * 99 / 100] / 1e6,
+           durations[stage][count - 1] / 1e6);
+  }
+
+  for (int stage = 0; stage < TIMING_STAGES; stage++) {
+    if (counts[stage] == 0)
+      continue;
+
+    printf("\n%s\n", STAGE_NAMES[stage]);
+    print_histogram(durations[stage], counts[stage]);
+  }
+
+  for (int stage = 0; stage < TIMING_STAGES; stage++)
+    free(durations[stage]);
+  free(spans);
+}
+
+bool timing_write_trace(const timing_t* timing,
+                        const char* file_name,
+                        uint64_t window) {
+  FILE* file = fopen(file_name, "w");
+  if (!file) {
+    printf("Could not write file: %s\n", file_name);
+    return false;
+  }
+
+  const uint64_t now = timing_now_ns();
+  const uint64_t from = now - timing->origin > window ? now - window : 0;
+  timing_span_t* spans = malloc(timing->capacity * sizeof(timing_span_t));
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (int i = 0; i < timing->thread_count; i++) {
+    const timing_thread_t* thread = &timing->threads[i];
+    fprintf(file,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s\"}}",
+            i ? ",\n" : "", i + 1, thread->name);
+
+    const uint32_t count = snapshot(timing, thread, spans);
+    for (uint32_t span = 0; span < count; span++) {
+      if (spans[span].start + spans[span].duration < from)
+        continue;
+
+      fprintf(file,
+              ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,"
+              "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+              STAGE_NAMES[spans[span].stage], i + 1,
+              (spans[span].start - timing->origin) / 1e3,
+              spans[span].duration / 1e3);
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  free(spans);
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,117 @@
+// micro-benchmark of the sprite drawing loop, which spends most of its
+// instructions on the shift register ports 2, 3 and 4
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <time.h>
+
+#include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/board.h"
+
+#define BENCH_SHIFT_DEFAULT_INSTRUCTIONS 100000000
+#define BENCH_SHIFT_OFFSET 5
+#define BENCH_SHIFT_ROWS 16
+#define BENCH_SHIFT_SPRITE 0x0100
+#define BENCH_SHIFT_DESTINATION 0x2400
+
+// modelled on the shifted sprite routine of the game: every row shifts a
+// sprite byte and a zero byte through the register and ORs both into vram
+static const uint8_t PROGRAM[] = {
+    0x31, 0x00, 0x24,  // 0000 LXI SP,2400
+    0x3e, 0x05,        // 0003 MVI A,05
+    0xd3, 0x02,        // 0005 OUT 2
+    0x11, 0x00, 0x01,  // 0007 LXI D,0100
+    0x21, 0x00, 0x24,  // 000a LXI H,2400
+    0x06, 0x10,        // 000d MVI B,10
+    0x1a,              // 000f LDAX D
+    0xd3, 0x04,        // 0010 OUT 4
+    0xdb, 0x03,        // 0012 IN 3
+    0xb6,              // 0014 ORA M
+    0x77,              // 0015 MOV M,A
+    0x23,              // 0016 INX H
+    0xaf,              // 0017 XRA A
+    0xd3, 0x04,        // 0018 OUT 4
+    0xdb, 0x03,        // 001a IN 3
+    0xb6,              // 001c ORA M
+    0x77,              // 001d MOV M,A
+    0x7d,              // 001e MOV A,L
+    0xc6, 0x1e,        // 001f ADI 1E, next row
+    0x6f,              // 0021 MOV L,A
+    0x13,              // 0022 INX D
+    0x05,              // 0023 DCR B
+    0xc2, 0x0f, 0x00,  // 0024 JNZ 000f
+    0xc3, 0x07, 0x00,  // 0027 JMP 0007
+};
+
+#define BENCH_SHIFT_LOOP_INSTRUCTIONS 15
+#define BENCH_SHIFT_LOOP_PORT_ACCESSES 4
+
+static const uint8_t SPRITE[BENCH_SHIFT_ROWS] = {
+    0x00, 0x18, 0x3c, 0x7e, 0xdb, 0xff, 0x24, 0x5a,
+    0xa5, 0x81, 0x42, 0x24, 0x18, 0x3c, 0x66, 0xc3,
+};
+
+static double seconds_between(const struct timespec* start,
+                              const struct timespec* end) {
+  return (end->tv_sec - start->tv_sec) +
+         (end->tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+// expected vram, the loop is idempotent after its first pass
+static bool check_result(const machine_t* machine) {
+  uint8_t expected[I8080_MAX_MEMORY] = {0};
+  uint16_t address = BENCH_SHIFT_DESTINATION;
+  uint16_t shift = 0;
+
+  for (int row = 0; row < BENCH_SHIFT_ROWS; row++) {
+    shift = (SPRITE[row] << 8) | (shift >> 8);
+    expected[address] |= shift >> (8 - BENCH_SHIFT_OFFSET);
+    address++;
+
+    shift >>= 8;
+    expected[address] |= shift >> (8 - BENCH_SHIFT_OFFSET);
+    address = (address & 0xff00) | ((address + 0x1e) & 0xff);
+  }
+
+  return memcmp(&expected[MACHINE_VRAM_START],
+                &machine->memory[MACHINE_VRAM_START], MACHINE_VRAM_SIZE) == 0;
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t instructions = BENCH_SHIFT_DEFAULT_INSTRUCTIONS;
+
+  if (argc == 2 && argv[1][0] != '-') {
+    instructions = strtoull(argv[1], NULL, 10);
+  } else if (argc != 1) {
+    printf("usage: %s [instructions]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  machine_t* machine = create_machine(machine_find_board("invaders"));
+  memcpy(machine->memory, PROGRAM, sizeof(PROGRAM));
+  memcpy(&machine->memory[BENCH_SHIFT_SPRITE], SPRITE, sizeof(SPRITE));
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  uint64_t cycles = 0;
+  for (uint64_t i = 0; i < instructions; i++)
+    cycles += machine_step(machine);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  const double seconds = seconds_between(&start, &end);
+  const double port_accesses = (double)instructions *
+                               BENCH_SHIFT_LOOP_PORT_ACCESSES /
+                               BENCH_SHIFT_LOOP_INSTRUCTIONS;
+
+  const bool valid = check_result(machine);
+  printf("%" PRIu64 " instructions in %.3f s\n", instructions, seconds);
+  printf("%.2f MIPS, %.2f emulated MHz, %.2f M port accesses/s\n",
+         instructions / seconds / 1e6, cycles / seconds / 1e6,
+         port_accesses / seconds / 1e6);
+  printf("%.2f ns per instruction, result %s\n", seconds * 1e9 / instructions,
+         valid ? "ok" : "WRONG");
+
+  destroy_machine(machine);
+  return valid ? 0 : EXIT_FAILURE;
+}
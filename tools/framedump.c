@@ -0,0 +1,122 @@
+// prints information about a frame archive and expands frames to images
+#include "arcade_machine/archive.h"
+
+static uint8_t buffer[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH][3];
+
+static FILE* create_file(const char* file_name) {
+  FILE* file = fopen(file_name, "wb");
+  if (!file) {
+    printf("Could not write file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  return file;
+}
+
+static void print_info(const archive_t* archive) {
+  printf("frames: %u (%.1f s)\n", archive->frame_count,
+         (double)archive->frame_count / MACHINE_FPS);
+  printf("keyframes: %u, every %u frames\n", archive->index_count,
+         archive->keyframe_interval);
+  printf("size: %zu bytes, %.1f bytes per frame\n", archive->size,
+         archive->frame_count ? (double)archive->size / archive->frame_count
+                              : 0.0);
+}
+
+static bool write_ppm(archive_t* archive, uint32_t frame, const char* name) {
+  if (!archive_render(archive, frame, buffer))
+    return false;
+
+  FILE* file = create_file(name);
+  fprintf(file, "P6\n%d %d\n255\n", MACHINE_SCREEN_WIDTH,
+          MACHINE_SCREEN_HEIGHT);
+  fwrite(buffer, sizeof(buffer), 1, file);
+  fclose(file);
+  return true;
+}
+
+// 8-bit mono, frames are read sequentially so each costs one delta
+static bool write_y4m(archive_t* archive,
+                      uint32_t from,
+                      uint32_t count,
+                      const char* name) {
+  static uint8_t luma[MACHINE_SCREEN_HEIGHT][MACHINE_SCREEN_WIDTH];
+
+  FILE* file = create_file(name);
+  fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n",
+          MACHINE_SCREEN_WIDTH, MACHINE_SCREEN_HEIGHT, MACHINE_FPS);
+
+  for (uint32_t frame = from; frame < from + count; frame++) {
+    if (!archive_render(archive, frame, buffer)) {
+      fclose(file);
+      return false;
+    }
+
+    for (int y = 0; y < MACHINE_SCREEN_HEIGHT; y++) {
+      for (int x = 0; x < MACHINE_SCREEN_WIDTH; x++)
+        luma[y][x] = buffer[y][x][0];
+    }
+
+    fputs("FRAME\n", file);
+    fwrite(luma, sizeof(luma), 1, file);
+  }
+
+  fclose(file);
+  return true;
+}
+
+static void print_usage(const char* program) {
+  printf(
+      "usage: %s <archive> [--ppm <frame> <file>] [--y4m <file>] "
+      "[--from <frame>] [--count <frames>]\n",
+      program);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  archive_t* archive = archive_open(argv[1]);
+  const char* ppm_file = NULL;
+  const char* y4m_file = NULL;
+  uint32_t ppm_frame = 0;
+  uint32_t from = 0;
+  uint32_t count = archive->frame_count;
+
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--ppm") == 0 && i + 2 < argc) {
+      ppm_frame = strtoul(argv[++i], NULL, 10);
+      ppm_file = argv[++i];
+    } else if (strcmp(argv[i], "--y4m") == 0 && i + 1 < argc) {
+      y4m_file = argv[++i];
+    } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+      from = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+      count = strtoul(argv[++i], NULL, 10);
+    } else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (from > archive->frame_count)
+    from = archive->frame_count;
+  if (count > archive->frame_count - from)
+    count = archive->frame_count - from;
+
+  print_info(archive);
+
+  bool valid = true;
+  if (ppm_file)
+    valid &= write_ppm(archive, ppm_frame, ppm_file);
+  if (y4m_file)
+    valid &= write_y4m(archive, from, count, y4m_file);
+
+  if (!valid)
+    printf("Frame missing or corrupt in archive: %s\n", argv[1]);
+
+  archive_close(archive);
+  return valid ? 0 : EXIT_FAILURE;
+}
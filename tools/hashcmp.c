@@ -0,0 +1,49 @@
+// reports the first frame at which two state hash logs diverge
+#include <inttypes.h>
+
+#include "arcade_machine/state_hash.h"
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    printf("usage: %s <hash log> <hash log>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE* first = state_hash_log_open(argv[1]);
+  FILE* second = state_hash_log_open(argv[2]);
+
+  uint64_t frame = 0;
+  int result = 0;
+
+  while (1) {
+    uint64_t hash1, hash2;
+    const bool has1 = state_hash_log_next(first, &hash1);
+    const bool has2 = state_hash_log_next(second, &hash2);
+
+    if (!has1 && !has2) {
+      printf("identical: %" PRIu64 " frames\n", frame);
+      break;
+    }
+
+    if (has1 != has2) {
+      printf("length differs: %s ends at frame %" PRIu64 "\n",
+             has1 ? argv[2] : argv[1], frame);
+      result = 1;
+      break;
+    }
+
+    if (hash1 != hash2) {
+      printf("diverged at frame %" PRIu64 ": %016" PRIx64 " != %016" PRIx64
+             "\n",
+             frame, hash1, hash2);
+      result = 1;
+      break;
+    }
+
+    frame++;
+  }
+
+  fclose(first);
+  fclose(second);
+  return result;
+}
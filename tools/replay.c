@@ -0,0 +1,286 @@
+// replays a recorded movie headlessly at maximum speed
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+
+#include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/board.h"
+#include "arcade_machine/capture.h"
+#include "arcade_machine/debug_server.h"
+#include "arcade_machine/metrics.h"
+#include "arcade_machine/movie.h"
+#include "arcade_machine/sound.h"
+#include "arcade_machine/state_hash.h"
+#include "arcade_machine/timing.h"
+#include "i8080/debug.h"
+#include "i8080/profile.h"
+#include "i8080/trace.h"
+
+static double seconds_between(const struct timespec* start,
+                              const struct timespec* end) {
+  return (end->tv_sec - start->tv_sec) +
+         (end->tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+static void dump_memory(const machine_t* machine, const char* file_name) {
+  FILE* file = fopen(file_name, "wb");
+  if (!file) {
+    printf("Could not write file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  fwrite(machine->memory, I8080_MAX_MEMORY, 1, file);
+  fclose(file);
+}
+
+// breakpoints and watchpoints log and continue, replay is not interactive
+static void report_stop(machine_t* machine, uint32_t frame) {
+  const i8080_debug_t* debug = machine->cpu.debug;
+
+  printf("frame %u: %s at %04x, ", frame, i8080_debug_stop_name(debug->stop),
+         debug->stop_address);
+  if (debug->stop != I8080_DEBUG_STOP_BREAK)
+    printf("value %02x, ", machine->memory[debug->stop_address]);
+  i8080_disassemble(machine->memory, machine->cpu.pc);
+  i8080_print(&machine->cpu);
+}
+
+// parses a hex address, creating the debugger on first use
+static bool add_debug_flags(i8080_debug_t** debug,
+                            const char* address,
+                            uint8_t flags) {
+  char* end;
+  const unsigned long value = strtoul(address, &end, 16);
+  if (*end != '\0' || value >= I8080_MAX_MEMORY)
+    return false;
+
+  if (!*debug)
+    *debug = create_i8080_debug();
+
+  i8080_debug_set(*debug, value, flags);
+  return true;
+}
+
+static void print_usage(const char* program) {
+  printf(
+      "usage: %s <movie> [--dump <file>] [--hash <file>] [--trace <file>] "
+      "[--profile] [--no-video] [--wav <file>] [--sounds <dir>] "
+      "[--capture <file>] [--board <name>] [--break <address>] "
+      "[--watch <address>] [--watch-read <address>] "
+      "[--debug-server <socket>] [--metrics <file> | --metrics-socket "
+      "<socket>] [--timing <file>] [--scanline]\n",
+      program);
+  printf("  --dump <file>  write memory after last frame to file\n");
+  printf("  --hash <file>  write state hash of every frame to file\n");
+  printf("  --trace <file> write last instructions to file on exit or crash\n");
+  printf("  --profile      print guest hot spots, needs make PROFILE=1\n");
+  printf("  --no-video     skip screen buffer conversion\n");
+  printf("  --wav <file>   render sound effects to file\n");
+  printf("  --sounds <dir> effects 0.wav to 8.wav, default %s\n",
+         SOUND_DIRECTORY);
+  printf("  --capture <file> write video to file, .y4m or frame archive\n");
+  printf("                 y4m repeats unchanged frames, the archive does not\n");
+  printf("  --board <name> hardware of movies that do not name it, default %s\n",
+         MACHINE_DEFAULT_BOARD);
+  printf("  --break <address>      log state before executing hex address\n");
+  printf("  --watch <address>      log instructions writing hex address\n");
+  printf("  --watch-read <address> log instructions reading hex address\n");
+  printf("  --debug-server <socket> serve a remote debugger, stops go there\n");
+  printf("  --metrics <file>        write Prometheus metrics every second\n");
+  printf("  --metrics-socket <socket> send Prometheus metrics to clients\n");
+  printf("  --timing <file>         write a trace of the last seconds to file\n");
+  printf("  --scanline              convert lines as the beam passes them\n");
+}
+
+int main(int argc, char* argv[]) {
+  const char* movie_file = NULL;
+  const char* dump_file = NULL;
+  const char* hash_file = NULL;
+  const char* trace_file = NULL;
+  const char* wav_file = NULL;
+  const char* capture_file = NULL;
+  const char* board_name = NULL;
+  const char* sound_directory = SOUND_DIRECTORY;
+  bool convert_video = true;
+  bool profile = false;
+  bool scanline = false;
+  i8080_debug_t* debug = NULL;
+  debug_server_t* debug_server = NULL;
+  metrics_t* metrics = NULL;
+  const char* timing_file = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+      dump_file = argv[++i];
+    else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc)
+      hash_file = argv[++i];
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+      trace_file = argv[++i];
+    else if (strcmp(argv[i], "--profile") == 0)
+      profile = true;
+    else if (strcmp(argv[i], "--no-video") == 0)
+      convert_video = false;
+    else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc)
+      wav_file = argv[++i];
+    else if (strcmp(argv[i], "--sounds") == 0 && i + 1 < argc)
+      sound_directory = argv[++i];
+    else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+      capture_file = argv[++i];
+    else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc)
+      board_name = argv[++i];
+    else if (strcmp(argv[i], "--break") == 0 && i + 1 < argc &&
+             add_debug_flags(&debug, argv[i + 1], I8080_DEBUG_BREAK))
+      i++;
+    else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc &&
+             add_debug_flags(&debug, argv[i + 1], I8080_DEBUG_WRITE))
+      i++;
+    else if (strcmp(argv[i], "--watch-read") == 0 && i + 1 < argc &&
+             add_debug_flags(&debug, argv[i + 1], I8080_DEBUG_READ))
+      i++;
+    else if (strcmp(argv[i], "--debug-server") == 0 && i + 1 < argc &&
+             (debug_server = create_debug_server(argv[i + 1])))
+      i++;
+    else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc && !metrics)
+      metrics = create_metrics(argv[++i], METRICS_FILE);
+    else if (strcmp(argv[i], "--metrics-socket") == 0 && i + 1 < argc &&
+             !metrics && (metrics = create_metrics(argv[i + 1], METRICS_SOCKET)))
+      i++;
+    else if (strcmp(argv[i], "--scanline") == 0)
+      scanline = true;
+    else if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc)
+      timing_file = argv[++i];
+    else if (!movie_file && argv[i][0] != '-')
+      movie_file = argv[i];
+    else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!movie_file) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  movie_t* movie = movie_load(movie_file);
+  const machine_board_t* board = machine_select_board(board_name, movie->board);
+  if (!board)
+    return EXIT_FAILURE;
+
+  machine_t* machine = create_machine(board);
+  machine_load_roms(machine);
+  machine->scanline = scanline;
+
+  if (hash_file)
+    machine->hash_log = state_hash_log_create(hash_file);
+
+  if (trace_file) {
+    machine->cpu.trace = create_i8080_trace(1 << 16);
+    i8080_trace_dump_on_crash(machine->cpu.trace, trace_file);
+  }
+
+  if (profile) {
+#ifndef I8080_PROFILE
+    printf("profiling not compiled in, rebuild with make PROFILE=1\n");
+#endif
+    machine->cpu.profile = create_i8080_profile();
+  }
+
+  if (wav_file) {
+    machine->sound = create_sound();
+    if (sound_load_effects(machine->sound, sound_directory) == 0)
+      printf("No sound effects found in %s\n", sound_directory);
+    machine->sound->wav = sound_wav_create(wav_file);
+  }
+
+  // without --break or --watch the server attaches its own once a client talks
+  machine->debug_server = debug_server;
+  machine->cpu.debug = debug;
+
+  if (metrics)
+    machine->metrics = metrics_register_thread(metrics);
+
+  timing_t* timing = NULL;
+  timing_thread_t* timing_thread = NULL;
+  if (timing_file) {
+    timing = create_timing(TIMING_DEFAULT_SPANS);
+    timing_thread = timing_register_thread(timing, "replay");
+  }
+
+  capture_t* capture = capture_file ? create_capture(capture_file) : NULL;
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  uint32_t frames = 0;
+  while (movie_next_frame(movie, &machine->in_port1, &machine->in_port2)) {
+    uint64_t span = timing ? timing_now_ns() : 0;
+    while (!machine_update_state(machine)) {
+      report_stop(machine, frames);
+      i8080_debug_resume(machine->cpu.debug);
+    }
+    if (timing)
+      span = timing_record(timing_thread, TIMING_EMULATION, span);
+
+    if (convert_video) {
+      machine_update_screen_buffer(machine);
+      if (timing)
+        timing_record(timing_thread, TIMING_CONVERSION, span);
+    }
+
+    if (capture)
+      capture_frame(capture, machine->memory);
+
+    frames++;
+  }
+
+  if (capture)
+    destroy_capture(capture);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  const double seconds = seconds_between(&start, &end);
+
+  printf("frames: %u\n", frames);
+  printf("time: %.3f s (%.1f fps, %.1fx real time)\n", seconds,
+         frames / seconds, frames / seconds / MACHINE_FPS);
+
+  if (dump_file)
+    dump_memory(machine, dump_file);
+
+  if (machine->hash_log)
+    fclose(machine->hash_log);
+
+  if (machine->sound) {
+    sound_wav_close(machine->sound->wav);
+    destroy_sound(machine->sound);
+  }
+
+  if (machine->cpu.profile) {
+    i8080_profile_report(machine->cpu.profile, machine->memory);
+    destroy_i8080_profile(machine->cpu.profile);
+  }
+
+  if (machine->cpu.trace) {
+    i8080_trace_save(machine->cpu.trace, trace_file);
+    destroy_i8080_trace(machine->cpu.trace);
+  }
+
+  if (debug_server)
+    destroy_debug_server(debug_server);
+
+  if (metrics)
+    destroy_metrics(metrics);
+
+  if (timing) {
+    timing_write_trace(timing, timing_file, TIMING_DEFAULT_WINDOW);
+    timing_report(timing);
+    destroy_timing(timing);
+  }
+
+  if (debug)
+    destroy_i8080_debug(debug);
+
+  destroy_machine(machine);
+  destroy_movie(movie);
+  return 0;
+}
@@ -0,0 +1,316 @@
+// runs the reference cpu core and an alternative core in lock-step, comparing
+// registers and memory writes after every instruction
+#include <inttypes.h>
+
+#include "arcade_machine/arcade_machine.h"
+#include "arcade_machine/board.h"
+
+#define VALIDATE_HISTORY 16              // instructions shown on mismatch
+#define VALIDATE_FULL_COMPARE (1 << 16)  // instructions between memcmp
+#define VALIDATE_DEFAULT_FRAMES 600      // attract mode, 10 seconds
+#define VALIDATE_CANDIDATES 11           // possible write addresses
+
+typedef struct {
+  const char* name;
+  void (*step)(i8080_t* cpu);
+} validate_core_t;
+
+// alternative cores are registered here as they are added. none exists yet,
+// the reference core against itself only exercises the harness
+static const validate_core_t CORES[] = {
+    {"reference", i8080_step},
+};
+
+static const char* DEFAULT_PROGRAMS[] = {
+    "i8080-emulator/tests/TST8080.COM", "i8080-emulator/tests/CPUTEST.COM",
+    "i8080-emulator/tests/8080PRE.COM", "i8080-emulator/tests/8080EXM.COM",
+    "invaders",
+};
+
+typedef struct {
+  uint64_t instructions;
+  uint16_t history[VALIDATE_HISTORY];  // pc of last instructions
+} validate_run_t;
+
+static const validate_core_t* find_core(const char* name) {
+  for (size_t i = 0; i < sizeof(CORES) / sizeof(CORES[0]); i++) {
+    if (strcmp(CORES[i].name, name) == 0)
+      return &CORES[i];
+  }
+
+  return NULL;
+}
+
+static uint8_t flags_byte(const i8080_t* cpu) {
+  return cpu->cb.flags.s << 7 | cpu->cb.flags.z << 6 | cpu->cb.flags.ac << 4 |
+         cpu->cb.flags.p << 2 | 1 << 1 | cpu->cb.flags.c;
+}
+
+static bool same_cpu_state(const i8080_t* reference, const i8080_t* other) {
+  return reference->a == other->a && reference->b == other->b &&
+         reference->c == other->c && reference->d == other->d &&
+         reference->e == other->e && reference->h == other->h &&
+         reference->l == other->l && reference->pc == other->pc &&
+         reference->sp == other->sp && reference->cycles == other->cycles &&
+         reference->ie == other->ie &&
+         flags_byte(reference) == flags_byte(other);
+}
+
+// every address an 8080 instruction can write is derived from BC, DE, HL,
+// SP or its 16-bit operand. SP-4 covers an interrupt following a push. the
+// operand bytes wrap at the top of memory like the cpu's own fetch
+static int write_candidates(const i8080_t* cpu, uint16_t* addresses) {
+  const uint8_t* memory = cpu->external_memory;
+  const uint16_t operand = (memory[(uint16_t)(cpu->pc + 2)] << 8) |
+                           memory[(uint16_t)(cpu->pc + 1)];
+  int count = 0;
+
+  addresses[count++] = (cpu->b << 8) | cpu->c;
+  addresses[count++] = (cpu->d << 8) | cpu->e;
+  addresses[count++] = (cpu->h << 8) | cpu->l;
+  for (int offset = -4; offset < 2; offset++)
+    addresses[count++] = cpu->sp + offset;
+  addresses[count++] = operand;
+  addresses[count++] = operand + 1;
+
+  return count;
+}
+
+// returns address of first differing byte, or -1
+static int32_t compare_memory(const uint8_t* reference,
+                              const uint8_t* other,
+                              const uint16_t* addresses,
+                              int count) {
+  for (int i = 0; i < count; i++) {
+    if (reference[addresses[i]] != other[addresses[i]])
+      return addresses[i];
+  }
+
+  return -1;
+}
+
+static int32_t compare_all_memory(const uint8_t* reference,
+                                  const uint8_t* other) {
+  if (memcmp(reference, other, I8080_MAX_MEMORY) == 0)
+    return -1;
+
+  for (int32_t address = 0; address < I8080_MAX_MEMORY; address++) {
+    if (reference[address] != other[address])
+      return address;
+  }
+
+  return -1;
+}
+
+static void report_mismatch(const validate_run_t* run,
+                            i8080_t* reference,
+                            i8080_t* other,
+                            const char* core_name,
+                            int32_t address) {
+  printf("\nMISMATCH after %" PRIu64 " instructions\n", run->instructions);
+
+  printf("last instructions (reference memory):\n");
+  const int count = run->instructions < VALIDATE_HISTORY
+                        ? (int)run->instructions
+                        : VALIDATE_HISTORY;
+  for (int i = count; i > 0; i--) {
+    const uint16_t pc =
+        run->history[(run->instructions - i) % VALIDATE_HISTORY];
+    i8080_disassemble(reference->external_memory, pc);
+  }
+
+  printf("\nreference:\n");
+  i8080_print(reference);
+  printf("%s:\n", core_name);
+  i8080_print(other);
+
+  if (address >= 0)
+    printf("memory at %04x: reference %02x, %s %02x\n", address,
+           reference->external_memory[address], core_name,
+           other->external_memory[address]);
+}
+
+// CP/M style test rom, BDOS output of the reference core is printed
+static bool validate_testrom(const char* file_name,
+                             const validate_core_t* core,
+                             uint64_t max_instructions) {
+  i8080_t reference, other;
+  init_i8080(&reference);
+  init_i8080(&other);
+  reference.external_memory = calloc(1, I8080_MAX_MEMORY);
+  other.external_memory = calloc(1, I8080_MAX_MEMORY);
+
+  FILE* file = fopen(file_name, "rb");
+  if (!file) {
+    printf("Could not read file: %s\n", file_name);
+    exit(EXIT_FAILURE);
+  }
+  fread(&reference.external_memory[0x100], 1, I8080_MAX_MEMORY - 0x100, file);
+  fclose(file);
+
+  reference.external_memory[5] = 0xc9;  // RET from BDOS call
+  reference.pc = 0x100;
+  memcpy(other.external_memory, reference.external_memory, I8080_MAX_MEMORY);
+  other.pc = reference.pc;
+
+  printf("*** %s (%s)\n", file_name, core->name);
+
+  validate_run_t run = {0};
+  bool valid = true;
+
+  while (reference.pc != 0 && run.instructions < max_instructions) {
+    if (reference.pc == 5) {
+      if (reference.c == 9) {
+        for (uint16_t i = (reference.d << 8 | reference.e);
+             reference.external_memory[i] != '$'; i++)
+          printf("%c", reference.external_memory[i]);
+      }
+
+      if (reference.c == 2)
+        printf("%c", reference.e);
+    }
+
+    uint16_t addresses[VALIDATE_CANDIDATES];
+    const int count = write_candidates(&reference, addresses);
+
+    run.history[run.instructions % VALIDATE_HISTORY] = reference.pc;
+    i8080_step(&reference);
+    core->step(&other);
+    run.instructions++;
+
+    int32_t address = compare_memory(reference.external_memory,
+                                     other.external_memory, addresses, count);
+    if (address < 0 && run.instructions % VALIDATE_FULL_COMPARE == 0)
+      address = compare_all_memory(reference.external_memory,
+                                   other.external_memory);
+
+    if (address >= 0 || !same_cpu_state(&reference, &other)) {
+      report_mismatch(&run, &reference, &other, core->name, address);
+      valid = false;
+      break;
+    }
+  }
+
+  if (valid)
+    printf("\n%" PRIu64 " instructions identical\n\n", run.instructions);
+
+  free(reference.external_memory);
+  free(other.external_memory);
+  return valid;
+}
+
+// space invaders attract mode, no input
+static bool validate_invaders(const validate_core_t* core, int frames) {
+  const machine_board_t* board = machine_find_board("invaders");
+  machine_t* reference = create_machine(board);
+  machine_t* other = create_machine(board);
+  machine_load_roms(reference);
+  memcpy(other->memory, reference->memory, I8080_MAX_MEMORY);
+
+  printf("*** invaders attract mode, %d frames (%s)\n", frames, core->name);
+
+  validate_run_t run = {0};
+  bool valid = true;
+
+  for (int frame = 0; frame < frames && valid; frame++) {
+    const uint64_t deadline =
+        (uint64_t)(frame + 1) * MACHINE_CYCLES_PER_FRAME;
+
+    while (reference->cpu.cycles < deadline) {
+      uint16_t addresses[VALIDATE_CANDIDATES];
+      const int count = write_candidates(&reference->cpu, addresses);
+
+      run.history[run.instructions % VALIDATE_HISTORY] = reference->cpu.pc;
+      machine_step(reference);
+      core->step(&other->cpu);
+      machine_check_interrupt(other);
+      run.instructions++;
+
+      const int32_t address = compare_memory(reference->memory, other->memory,
+                                             addresses, count);
+
+      if (address >= 0 || !same_cpu_state(&reference->cpu, &other->cpu)) {
+        report_mismatch(&run, &reference->cpu, &other->cpu, core->name,
+                        address);
+        valid = false;
+        break;
+      }
+    }
+
+    if (valid) {
+      const int32_t address =
+          compare_all_memory(reference->memory, other->memory);
+      if (address >= 0) {
+        report_mismatch(&run, &reference->cpu, &other->cpu, core->name,
+                        address);
+        valid = false;
+      }
+    }
+  }
+
+  if (valid)
+    printf("%" PRIu64 " instructions identical\n\n", run.instructions);
+
+  destroy_machine(reference);
+  destroy_machine(other);
+  return valid;
+}
+
+static void print_usage(const char* program) {
+  printf(
+      "usage: %s [--core <name>] [--max-instructions <n>] [--frames <n>] "
+      "[program...]\n",
+      program);
+  printf("  program is a CP/M .COM test rom or \"invaders\"\n");
+  printf("  the reference core runs against the core named by --core\n");
+  printf("cores:");
+  for (size_t i = 0; i < sizeof(CORES) / sizeof(CORES[0]); i++)
+    printf(" %s", CORES[i].name);
+  printf("\n");
+  printf("  only the reference core exists, it is compared against itself\n");
+}
+
+int main(int argc, char* argv[]) {
+  const validate_core_t* core = &CORES[sizeof(CORES) / sizeof(CORES[0]) - 1];
+  uint64_t max_instructions = UINT64_MAX;
+  int frames = VALIDATE_DEFAULT_FRAMES;
+  const char** programs = DEFAULT_PROGRAMS;
+  int program_count = sizeof(DEFAULT_PROGRAMS) / sizeof(DEFAULT_PROGRAMS[0]);
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "--core") == 0 && i + 1 < argc) {
+      core = find_core(argv[++i]);
+      if (!core) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--max-instructions") == 0 && i + 1 < argc) {
+      max_instructions = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (i < argc) {
+    programs = (const char**)&argv[i];
+    program_count = argc - i;
+  }
+
+  int failures = 0;
+  for (int program = 0; program < program_count; program++) {
+    const bool valid =
+        strcmp(programs[program], "invaders") == 0
+            ? validate_invaders(core, frames)
+            : validate_testrom(programs[program], core, max_instructions);
+
+    failures += !valid;
+  }
+
+  printf("%d of %d programs identical\n", program_count - failures,
+         program_count);
+  return failures ? EXIT_FAILURE : 0;
+}